@@ -0,0 +1,395 @@
+// To compile: gcc -O2 hough_model.c -o hough_model -lpthread
+// To run: ./hough_model [--sweep] [--addr-width N] [--calc-cycles N] [--top-n N] [--clock MHz] [images/ | file.bmp ...]
+//
+// Transaction-level model of rtl/hough.vhd. The edge maps come from the golden model in
+// lanedetect.c, the accumulator banking, vote arithmetic, per-bank top-N lists and the lane
+// selection follow the RTL register by register, and the cycles are counted per state instead
+// of simulated, so a whole sweep over c/images takes well under a second.
+
+#define LANEDETECT_NO_MAIN
+#include "lanedetect.c"
+
+#include <unistd.h>
+
+// Generics of the hough instance in lanedetect_top.vhd
+#define MODEL_RHO_RES_LOG RHO_RESOLUTION_LOG
+#define MODEL_RHOS RHOS
+#define MODEL_THETAS THETAS
+#define MODEL_SUM_BITS 18       // g_TOP_BITS + g_BOT_BITS
+#define MODEL_DATA_WIDTH 10     // g_BRAM_DATA_WIDTH
+#define MODEL_COUNTER_MAX 511   // q_row/q_col are signed(9 downto 0)
+#define MODEL_TOP_N 8           // g_TOP_N, the top level's 8 (the component declaration says 16)
+#define MODEL_MAX_TOP_N 64
+#define MODEL_CALC_CYCLES 7     // s_CALC steps per theta: q_count_calc = 0..6
+
+struct hough_model_config {
+    int addr_width;   // g_BRAM_ADDR_WIDTH, sets the thetas per bank and so the bank count
+    int top_n;        // g_TOP_N, entries kept per bank
+    int calc_cycles;  // Cycles per theta step in s_CALC, 7 in the RTL, 1 if fully pipelined
+    double clock_mhz;
+};
+
+struct hough_model_result {
+    int theta_per_bram;  // c_THETA_PER_BRAM
+    int brams;           // c_BRAMS
+
+    // Cycles spent in each state group
+    long long idle;      // s_IDLE: clearing the banks
+    long long read;      // s_READ: one per pixel
+    long long calc;      // s_CALC: per edge pixel
+    long long find;      // s_FINDL0 .. s_FIND: lane selection over every bank's top-N list
+    long long write;     // s_WRITE
+    long long total;
+
+    // Outputs, as driven on o_LEFT_RHO .. o_RIGHT_THETA and o_WR_EN
+    int left_rho;
+    int left_theta;
+    int right_rho;
+    int right_theta;
+    int left_votes;
+    int right_votes;
+    int wr_en;
+};
+
+static inline int model_wrap_signed(long long value, int bits) {
+    // resize() of a signed value to `bits`, i.e. two's complement wraparound
+    long long mask = (1LL << bits) - 1;
+    long long v = value & mask;
+    return (int)(v >= (1LL << (bits - 1)) ? v - (1LL << bits) : v);
+}
+
+static inline int model_resize_signed(int value, int bits) {
+    // numeric_std resize() of a signed value to fewer bits keeps the sign bit and the low bits
+    int low = value & ((1 << (bits - 1)) - 1);
+    return value < 0 ? low | (1 << (bits - 1)) : low;
+}
+
+static inline int model_in_band(int theta) {
+    // The s_CALC write filter: votes outside the lane bands are written back as 0
+    return !((theta > 160) || (theta < 100 && theta > 80) || (theta < 20));
+}
+
+static int hough_model_check(const struct hough_model_config *cfg, int height, int width) {
+    if (cfg->addr_width < 9 || cfg->addr_width > 16) {
+        // The theta compares are to_unsigned(160, g_BRAM_ADDR_WIDTH - 1) and the lane offsets are
+        // signed(g_BRAM_ADDR_WIDTH), and Quartus caps a bank at 2^20 bits
+        fprintf(stderr, "Error: g_BRAM_ADDR_WIDTH must be 9..16, not %d\n", cfg->addr_width);
+        return -1;
+    }
+    if (cfg->top_n < 1 || cfg->top_n > MODEL_MAX_TOP_N || cfg->calc_cycles < 1) {
+        fprintf(stderr, "Error: Invalid top-N (%d) or calc cycles (%d)\n", cfg->top_n, cfg->calc_cycles);
+        return -1;
+    }
+    if (height - 1 > MODEL_COUNTER_MAX || width - 1 > MODEL_COUNTER_MAX) {
+        fprintf(stderr, "Error: %dx%d frames overflow the 10-bit row/column counters\n", width, height);
+        return -1;
+    }
+    return 0;
+}
+
+int hough_model_run(const struct hough_model_config *cfg, const unsigned char *edges, int height, int width, struct hough_model_result *res) {
+/**
+    * @brief Runs one frame through the model of rtl/hough.vhd.
+    *
+    * Assumes the input FIFO never runs empty and the output FIFOs never fill, so the cycle
+    * counts are the Hough block's own throughput limit.
+    *
+    * @param cfg     Generics and clock to model.
+    * @param edges   height * width ROI edge map in FIFO order (row 0 first).
+    * @param height  g_HEIGHT.
+    * @param width   g_WIDTH.
+    * @param res     Cycle counts and outputs.
+    *
+    * @return 0 on success, -1 if the RTL cannot be built with these generics.
+*/
+    if (hough_model_check(cfg, height, width) != 0) return -1;
+
+    int depth = 1 << cfg->addr_width;
+    int max_addr = depth - 1;
+    int addr_mask = depth - 1;
+    int data_mask = (1 << MODEL_DATA_WIDTH) - 1;
+    int tpb = depth / MODEL_RHOS;
+    int brams = (MODEL_THETAS + tpb - 1) / tpb;
+    int top_n = cfg->top_n;
+
+    memset(res, 0, sizeof(struct hough_model_result));
+    res->theta_per_bram = tpb;
+    res->brams = brams;
+
+    unsigned short *mem = calloc((size_t)brams * depth, sizeof(unsigned short));
+    int (*top_rho)[MODEL_MAX_TOP_N] = calloc(brams, sizeof *top_rho);
+    int (*top_theta)[MODEL_MAX_TOP_N] = calloc(brams, sizeof *top_theta);
+    int (*top_votes)[MODEL_MAX_TOP_N] = calloc(brams, sizeof *top_votes);
+    if (!mem || !top_rho || !top_theta || !top_votes) {
+        fprintf(stderr, "Error: Failed to allocate Hough model state\n");
+        free(mem);
+        free(top_rho);
+        free(top_theta);
+        free(top_votes);
+        return -1;
+    }
+
+    // s_IDLE writes zero to one address of every bank per cycle, q_count = 0 .. c_MAX_ADDR
+    res->idle = depth;
+
+    // s_READ takes one cycle per pixel, each edge pixel then spends c_THETA_PER_BRAM theta
+    // steps in s_CALC with every bank working on its own theta
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            res->read++;
+            if (edges[row * width + col] == 0) continue;
+
+            int xs = (col - width / 2) >> MODEL_RHO_RES_LOG;
+            int ys = (row - height / 2) >> MODEL_RHO_RES_LOG;
+            for (int count = 0; count < tpb; count++) {
+                for (int i = 0; i < brams; i++) {
+                    int theta = count + tpb * i;
+                    // Banks past g_THETAS park on c_MAX_ADDR and write 0 there
+                    int rho = 0;
+                    int addr = max_addr;
+                    if (theta < MODEL_THETAS) {
+                        int sum = model_wrap_signed((long long)xs * COS_TABLE[theta] + (long long)ys * SIN_TABLE[theta], MODEL_SUM_BITS);
+                        rho = model_wrap_signed(DEQUANTIZE(sum) + MODEL_RHOS / 2, MODEL_SUM_BITS);
+                        // unsigned(q_rho) + q_count * g_RHOS, truncated to the address width, so an
+                        // out-of-range rho lands in another theta's bins as in the RTL
+                        addr = (rho + count * MODEL_RHOS) & addr_mask;
+                    }
+                    unsigned short *cell = &mem[(size_t)i * depth + addr];
+                    int votes = model_in_band(theta) ? (*cell + 1) & data_mask : 0;
+                    *cell = (unsigned short)votes;
+
+                    // Insert into this bank's top-N list, shifting the lower ranks down
+                    if (addr == max_addr) continue;
+                    for (int rank = 0; rank < top_n; rank++) {
+                        if (votes > top_votes[i][rank]) {
+                            for (int k = top_n - 1; k > rank; k--) {
+                                top_rho[i][k] = top_rho[i][k - 1];
+                                top_theta[i][k] = top_theta[i][k - 1];
+                                top_votes[i][k] = top_votes[i][k - 1];
+                            }
+                            top_rho[i][rank] = model_resize_signed(rho, cfg->addr_width);
+                            top_theta[i][rank] = theta;
+                            top_votes[i][rank] = votes;
+                            break;
+                        }
+                    }
+                }
+            }
+            res->calc += (long long)tpb * cfg->calc_cycles;
+        }
+    }
+
+    // s_FINDL0 -> [s_FINDL1] -> s_FINDR0 -> [s_FINDR1] -> s_FIND for every list entry
+    int left_votes = 0, left_rho = 0, left_theta = 0;
+    int right_votes = 0, right_rho = 0, right_theta = 0;
+    for (int i = 0; i < brams; i++) {
+        for (int k = 0; k < top_n; k++) {
+            int theta = top_theta[i][k];
+            int votes = top_votes[i][k];
+            res->find += 3;
+            if (theta >= LEFT_LANE_LB && theta <= LEFT_LANE_UB) {
+                res->find++;
+                if (votes > left_votes || (votes == left_votes && abs(theta - 130) < abs(left_theta - 130))) {
+                    left_votes = votes;
+                    left_rho = top_rho[i][k];
+                    left_theta = theta;
+                }
+            }
+            if (theta >= RIGHT_LANE_LB && theta <= RIGHT_LANE_UB) {
+                res->find++;
+                if (votes > right_votes || (votes == right_votes && abs(theta - 50) < abs(right_theta - 50))) {
+                    right_votes = votes;
+                    right_rho = top_rho[i][k];
+                    right_theta = theta;
+                }
+            }
+        }
+    }
+    res->write = 1;
+    res->total = res->idle + res->read + res->calc + res->find + res->write;
+
+    res->left_rho = left_rho;
+    res->left_theta = left_theta;
+    res->right_rho = right_rho;
+    res->right_theta = right_theta;
+    res->left_votes = left_votes;
+    res->right_votes = right_votes;
+    res->wr_en = left_votes != 0 && right_votes != 0;
+
+    free(mem);
+    free(top_rho);
+    free(top_theta);
+    free(top_votes);
+    return 0;
+}
+
+// Golden Reference
+//  The edge map and the lanes calculate_center_lane() picks from it, for comparison.
+struct model_frame {
+    char name[64];
+    int height;
+    int width;
+    int edge_pixels;
+    unsigned char *edges;
+    int left_rho_idx, left_theta_idx;
+    int right_rho_idx, right_theta_idx;
+};
+
+static int model_frame_load(const char *path, struct model_frame *fr) {
+    struct bmp_view view;
+    if (bmp_view_open(path, &view) != 0) return -1;
+
+    const char *base = strrchr(path, '/');
+    snprintf(fr->name, sizeof fr->name, "%.63s", base ? base + 1 : path);
+    fr->height = view.height;
+    fr->width = view.width;
+    fr->edges = malloc((size_t)view.height * view.width);
+    unsigned char *lanes = malloc((size_t)view.height * view.width);
+    int rhos = hough_rhos(view.height, view.width);
+    unsigned int *accumulator = malloc(sizeof(unsigned int) * rhos * THETAS);
+    struct edge_stream *stream = edge_stream_create(view.height, view.width);
+    int res = -1;
+    if (fr->edges && lanes && accumulator && stream &&
+        edge_stream_frame_strided(stream, view.pixels, view.stride, fr->edges, accumulator) == 0) {
+        int rho_indices[TOP_N], theta_indices[TOP_N], vote_counts[TOP_N];
+        extract_top_lines(accumulator, rhos, rho_indices, theta_indices, vote_counts);
+        memcpy(lanes, fr->edges, (size_t)view.height * view.width);
+        calculate_center_lane(lanes, view.height, view.width, rho_indices, theta_indices, vote_counts,
+                              &fr->left_rho_idx, &fr->left_theta_idx, &fr->right_rho_idx, &fr->right_theta_idx);
+        fr->edge_pixels = 0;
+        for (int i = 0; i < view.height * view.width; i++) {
+            fr->edge_pixels += fr->edges[i] != 0;
+        }
+        res = 0;
+    }
+    edge_stream_destroy(stream);
+    free(accumulator);
+    free(lanes);
+    bmp_view_close(&view);
+    if (res != 0) free(fr->edges);
+    return res;
+}
+
+static void model_report(FILE *csv, const struct model_frame *fr, const struct hough_model_config *cfg) {
+    struct hough_model_result r;
+    if (hough_model_run(cfg, fr->edges, fr->height, fr->width, &r) != 0) return;
+    int golden = r.left_rho == fr->left_rho_idx && r.left_theta == fr->left_theta_idx &&
+                 r.right_rho == fr->right_rho_idx && r.right_theta == fr->right_theta_idx;
+    fprintf(csv, "%s,%d,%d,%d,%d,%d,%d,%d,%d,%lld,%lld,%lld,%lld,%lld,%lld,%.1f,%.1f,%d,%d,%d,%d,%d,%d\n",
+            fr->name, fr->width, fr->height, fr->edge_pixels, cfg->addr_width, r.brams, r.theta_per_bram, cfg->top_n,
+            cfg->calc_cycles, r.idle, r.read, r.calc, r.find, r.write, r.total, cfg->clock_mhz,
+            cfg->clock_mhz * 1e6 / r.total, r.left_rho, r.left_theta, r.right_rho, r.right_theta, r.wr_en, golden);
+}
+
+int main(int argc, char *argv[]) {
+    struct hough_model_config cfg = { 10, MODEL_TOP_N, MODEL_CALC_CYCLES, 100.0 };
+    int sweep = 0;
+    int first_path = argc;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sweep") == 0) {
+            sweep = 1;
+        } else if (strcmp(argv[i], "--addr-width") == 0 && i + 1 < argc) {
+            cfg.addr_width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--calc-cycles") == 0 && i + 1 < argc) {
+            cfg.calc_cycles = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--top-n") == 0 && i + 1 < argc) {
+            cfg.top_n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+            cfg.clock_mhz = atof(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            first_path = i;
+            break;
+        } else {
+            printf("Usage: %s [--sweep] [--addr-width N] [--calc-cycles N] [--top-n N] [--clock MHz] [image_dir | file.bmp ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // Collect the frames: every BMP in a directory, or the files given
+    int capacity = 16;
+    int n_frames = 0;
+    struct model_frame *frames = malloc(sizeof(struct model_frame) * capacity);
+    if (!frames) {
+        fprintf(stderr, "Error: Failed to allocate frames\n");
+        return 1;
+    }
+    const char *default_dir[] = { "images" };
+    const char **paths = first_path < argc ? (const char **)&argv[first_path] : default_dir;
+    int n_paths = first_path < argc ? argc - first_path : 1;
+
+    // The golden model prints its diagnostics on stdout, so the CSV goes to a copy of it
+    fflush(stdout);
+    FILE *csv = fdopen(dup(fileno(stdout)), "w");
+    if (!csv || !freopen("/dev/null", "w", stdout)) {
+        fprintf(stderr, "Error: Could not redirect stdout\n");
+        return 1;
+    }
+
+    for (int p = 0; p < n_paths; p++) {
+        struct stat st;
+        struct dirent **entries = NULL;
+        int n = 0;
+        if (stat(paths[p], &st) == 0 && S_ISDIR(st.st_mode)) {
+            n = scandir(paths[p], &entries, frame_source_bmp_filter, alphasort);
+        }
+        for (int e = 0; e < (n > 0 ? n : 1); e++) {
+            char path[1024];
+            if (n > 0) {
+                snprintf(path, sizeof path, "%s/%s", paths[p], entries[e]->d_name);
+                free(entries[e]);
+            } else {
+                snprintf(path, sizeof path, "%s", paths[p]);
+            }
+            if (n_frames == capacity) {
+                struct model_frame *grown = realloc(frames, sizeof(struct model_frame) * capacity * 2);
+                if (!grown) {
+                    fprintf(stderr, "Error: Failed to allocate frames, skipping %s\n", path);
+                    continue;
+                }
+                frames = grown;
+                capacity *= 2;
+            }
+            struct model_frame *fr = &frames[n_frames];
+            if (model_frame_load(path, fr) != 0) {
+                fprintf(stderr, "Error: Skipping %s\n", path);
+                continue;
+            }
+            if (fr->height - 1 > MODEL_COUNTER_MAX || fr->width - 1 > MODEL_COUNTER_MAX) {
+                fprintf(stderr, "Skipping %s: %dx%d overflows the RTL's 10-bit row/column counters\n", path, fr->width, fr->height);
+                free(fr->edges);
+                continue;
+            }
+            n_frames++;
+        }
+        free(entries);
+    }
+
+    fprintf(csv, "frame,width,height,edge_pixels,addr_width,brams,theta_per_bram,top_n,calc_cycles,"
+                 "idle_cycles,read_cycles,calc_cycles_total,find_cycles,write_cycles,total_cycles,clock_mhz,fps,"
+                 "left_rho,left_theta,right_rho,right_theta,wr_en,matches_golden\n");
+    for (int f = 0; f < n_frames; f++) {
+        if (!sweep) {
+            model_report(csv, &frames[f], &cfg);
+            continue;
+        }
+        // Bank sizes from 18 banks of 10 thetas down to a single bank, with the RTL's 7-cycle
+        // theta step and pipelined alternatives
+        static const int calc_cycles[] = { MODEL_CALC_CYCLES, 3, 1 };
+        static const int top_ns[] = { 8, 16 };
+        for (int a = 9; a <= 14; a++) {
+            for (size_t c = 0; c < sizeof calc_cycles / sizeof calc_cycles[0]; c++) {
+                for (size_t t = 0; t < sizeof top_ns / sizeof top_ns[0]; t++) {
+                    struct hough_model_config point = { a, top_ns[t], calc_cycles[c], cfg.clock_mhz };
+                    model_report(csv, &frames[f], &point);
+                }
+            }
+        }
+    }
+
+    for (int f = 0; f < n_frames; f++) {
+        free(frames[f].edges);
+    }
+    free(frames);
+    fclose(csv);
+    return 0;
+}
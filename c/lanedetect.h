@@ -0,0 +1,154 @@
+// Lane detection library interface, implemented in lanedetect.c.
+// To build as a library: gcc -c -O2 -DLANEDETECT_NO_MAIN lanedetect.c
+//
+// A context preallocates every buffer for one frame size. lanedetect_process_frame() then runs
+// the fused pipeline on a frame in place without allocating, printing or touching files, so it
+// can be called from a control loop. Intermediate rows can be observed through capture hooks.
+
+#ifndef LANEDETECT_H
+#define LANEDETECT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Decimation of capture frames (see decimate_to_grayscale)
+#define DECIMATE_SAMPLE 0  // One pixel per 4x4 block, like sample_every_4.v
+#define DECIMATE_BOX 1     // 4x4 box average
+#define DECIMATE_BOX2X2 2  // 2x2 average of 2x2 averages
+
+// Peak extractor flags (see extract_top_lines_fast)
+#define PEAKS_LOCAL_MAX 0x1 // Only keep 3x3 local maxima in (rho, theta) space
+#define PEAKS_PER_LANE  0x2 // Only return the strongest peak of each lane band
+
+// Frame status
+#define LANEDETECT_OK            0
+#define LANEDETECT_NO_LANES      1 // Neither lane found, steering is 0
+#define LANEDETECT_NO_LEFT_LANE  2 // Steering is 0
+#define LANEDETECT_NO_RIGHT_LANE 3 // Steering is 0
+#define LANEDETECT_DIVIDE_ERROR  4 // A lane is vertical in the Hough space, steering is 0
+
+// Capture stages, one row at a time at the pipeline size
+#define LANEDETECT_CAPTURE_GRAY  0 // Grayscale (after decimation)
+#define LANEDETECT_CAPTURE_BLUR  1 // Gaussian blur
+#define LANEDETECT_CAPTURE_SOBEL 2 // Gradient magnitude
+#define LANEDETECT_CAPTURE_NMS   3 // Non-maximum suppression
+#define LANEDETECT_CAPTURE_EDGES 4 // Hysteresis inside the ROI, the map the Hough transform votes
+#define LANEDETECT_CAPTURE_STAGES 5
+
+// Region of interest, in pipeline coordinates (after decimation) with row 0 at the bottom of the
+// frame. Only edges inside it are voted, and the context computes nothing that cannot reach it.
+#define LANEDETECT_ROI_DEFAULT   0 // Rows 0 to height / 3, like region_of_interest()
+#define LANEDETECT_ROI_ROWS      1 // Rows row_begin to row_end - 1, whole rows
+#define LANEDETECT_ROI_TRAPEZOID 2 // Rows row_begin to row_end - 1, columns interpolated between the two edges
+#define LANEDETECT_ROI_POLYGON   3 // Pixels whose center is inside the polygon, which must be convex
+#define LANEDETECT_ROI_MAX_POINTS 8
+
+struct lanedetect_roi {
+    int kind;          // LANEDETECT_ROI_*
+    int row_begin;     // Rows and trapezoid
+    int row_end;
+    int bottom_left;   // Trapezoid columns bottom_left to bottom_right - 1 on row_begin,
+    int bottom_right;  // top_left to top_right - 1 on row_end - 1
+    int top_left;
+    int top_right;
+    int n_points;      // Polygon vertices, x then y
+    int points[LANEDETECT_ROI_MAX_POINTS][2];
+};
+
+struct lanedetect_config {
+    int height;       // Size of the frames passed to lanedetect_process_frame()
+    int width;
+    int decimate;     // DECIMATE_* to run the pipeline on frames shrunk by 4, or -1
+    int peak_flags;   // PEAKS_* flags of the peak extractor
+    int min_votes;    // Minimum votes for a peak
+    int track;        // Track the lanes between frames
+    int incremental;  // 1 to vote only edge map changes, 2 to also verify them
+    int bands;        // Run the edge stages in this many row bands on their own threads, 0 or 1 for none
+    const struct lanedetect_roi *roi;  // Region of interest, NULL for LANEDETECT_ROI_DEFAULT
+    int gradient_k;   // Vote only within this many thetas of each edge pixel's gradient angle, 0 for the whole bands
+    int coarse;       // 1 to vote coarse-to-fine, refining only the best cells of each band
+    int progressive;  // 1 to vote a seeded random sample of the edge pixels within max_votes, 2 to also
+                      // compare every frame with exhaustive voting
+    int max_votes;    // Progressive vote budget per frame (band thetas per edge pixel), 0 for none
+    unsigned int seed;  // Progressive pixel order, 0 for the default
+};
+
+struct lanedetect_result {
+    int status;        // LANEDETECT_OK or why there is no steering
+    float steering;    // Same value as calculate_center_lane()
+    int left_rho_idx;  // Lanes in accumulator indices, -1 if not found
+    int left_theta_idx;
+    int right_rho_idx;
+    int right_theta_idx;
+    int left_votes;
+    int right_votes;
+    float confidence;  // Votes of the weaker lane over the ROI rows, 0 to 1, 0 without both lanes
+};
+
+// Telemetry, counted by every context unless built with -DLANEDETECT_NO_STATS, which compiles the
+// counting out of the frame loop (the functions below then report zeros)
+#define LANEDETECT_SATURATED_VOTES 256 // A bin with more votes counts as saturated
+
+struct lanedetect_frame_stats {
+    long long frame;     // Frames processed before this one
+    int edge_pixels;     // ROI edge pixels
+    int votes;           // Votes in the accumulator
+    int out_of_range;    // Votes whose rho fell outside the accumulator
+    int saturated_bins;  // Bins with more than LANEDETECT_SATURATED_VOTES votes
+    int status;          // LANEDETECT_* status of the frame
+};
+
+struct lanedetect_stats {
+    long long frames;
+    long long edge_pixels;
+    long long votes;
+    long long out_of_range;
+    long long saturated_bins;
+    long long no_lanes;       // Frames per status
+    long long no_left_lane;
+    long long no_right_lane;
+    long long divide_guards;
+};
+
+struct lanedetect_ctx;
+
+struct lanedetect_ctx *lanedetect_create(const struct lanedetect_config *config);
+void lanedetect_destroy(struct lanedetect_ctx *ctx);
+void lanedetect_pipeline_size(const struct lanedetect_ctx *ctx, int *height, int *width);
+void lanedetect_set_capture(struct lanedetect_ctx *ctx, unsigned int stages,
+                            void (*capture)(void *user, int stage, int y, const unsigned char *row, int width), void *user);
+int lanedetect_process_frame(struct lanedetect_ctx *ctx, const unsigned char *rgb, ptrdiff_t stride, struct lanedetect_result *result);
+
+void lanedetect_get_stats(const struct lanedetect_ctx *ctx, struct lanedetect_frame_stats *frame, struct lanedetect_stats *total);
+void lanedetect_reset_stats(struct lanedetect_ctx *ctx);
+void lanedetect_stats_add(struct lanedetect_stats *total, const struct lanedetect_frame_stats *frame);
+int lanedetect_stats_write_json(FILE *f, const struct lanedetect_stats *stats);
+int lanedetect_stats_write_csv(FILE *f, const struct lanedetect_stats *stats, int header);
+
+// Pipelined execution, mirroring the FIFO chain of rtl/lanedetect_top.vhd: the caller converts
+// rows to grayscale, and blur/Sobel, NMS/hysteresis/ROI/Hough and the lane calculation each run
+// on their own thread. Stages pass rows through bounded FIFOs and stall while their output is
+// full. Tracking, incremental, gradient, coarse-to-fine and progressive voting, row bands and
+// capture hooks are not available in this mode.
+#define LANEDETECT_PIPELINE_FIFOS 4
+
+struct lanedetect_fifo_stats {
+    const char *name;
+    int depth;                // Capacity in items (rows, frames or results)
+    long long writer_stalls;  // Times the writer found the FIFO full
+    long long reader_stalls;  // Times the reader found it empty
+};
+
+struct lanedetect_pipeline;
+
+struct lanedetect_pipeline *lanedetect_pipeline_create(const struct lanedetect_config *config, int depth);
+void lanedetect_pipeline_destroy(struct lanedetect_pipeline *p);
+int lanedetect_pipeline_push(struct lanedetect_pipeline *p, const unsigned char *rgb, ptrdiff_t stride);
+int lanedetect_pipeline_pop(struct lanedetect_pipeline *p, struct lanedetect_result *result, int wait);
+void lanedetect_pipeline_get_stats(const struct lanedetect_pipeline *p, struct lanedetect_stats *total,
+                                   struct lanedetect_fifo_stats fifos[LANEDETECT_PIPELINE_FIFOS]);
+
+const char *lanedetect_status_message(int status);
+void lanedetect_draw_lanes(unsigned char *image, int height, int width, const struct lanedetect_result *result);
+
+#endif // LANEDETECT_H
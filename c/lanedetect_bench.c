@@ -0,0 +1,903 @@
+// To compile: gcc -O2 lanedetect_bench.c -o lanedetect_bench -lpthread  (add -mavx2 for the AVX2 kernels)
+// To run: ./lanedetect_bench [stages] [--iterations N] [image_dir]   per-stage timings as CSV
+//         ./lanedetect_bench hough [max_threads]                    parallel Hough scaling
+//         ./lanedetect_bench bands [max_threads]                    row-band edge stage scaling
+//         ./lanedetect_bench roi                                    ROI row/column skipping
+//         ./lanedetect_bench coarse [image_dir]                     coarse-to-fine Hough vs the flat transform
+//         ./lanedetect_bench progressive [image_dir]                progressive Hough pixels voted and lane changes
+//         ./lanedetect_bench layout [image_dir]                     rho-major vs theta-major band accumulator
+
+#define LANEDETECT_NO_MAIN
+#include "lanedetect.c"
+
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_WARMUP 3
+#define BENCH_SEED 12345
+#define BENCH_PIXELS_PER_STAGE 40000000 // Pixels processed per stage to size the iteration count
+
+static const int bench_sizes[][2] = {
+    { 120, 160 },   // Internal processing resolution
+    { 480, 640 },   // D8M capture resolution
+    { 540, 720 },   // houghline() in hough.c
+};
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int synth_edges(unsigned char *edges, int height, int width, int noise_permille) {
+/**
+    * @brief Fills a synthetic edge map with two lane lines plus random noise.
+    *
+    * @param edges           height * width edge map.
+    * @param height          Height of the frame.
+    * @param width           Width of the frame.
+    * @param noise_permille  Probability (per 1000) of a noise pixel.
+    *
+    * @return Number of edge pixels.
+*/
+    int count = 0;
+    memset(edges, 0, (size_t)height * width);
+    for (int y = 0; y < height; y++) {
+        int left = width / 2 - (y * width) / (2 * height) - 1;
+        int right = width / 2 + (y * width) / (2 * height);
+        if (left >= 0) edges[y * width + left] = 255;
+        if (right < width) edges[y * width + right] = 255;
+        for (int x = 0; x < width; x++) {
+            if (rand() % 1000 < noise_permille) edges[y * width + x] = 255;
+        }
+    }
+    for (int i = 0; i < height * width; i++) {
+        count += edges[i] != 0;
+    }
+    return count;
+}
+
+static void synth_frame(struct pixel *data, int height, int width) {
+/**
+    * @brief Fills a synthetic road frame: dark asphalt, two bright lanes and sensor noise.
+*/
+    for (int y = 0; y < height; y++) {
+        int left = width / 2 - (y * width) / (2 * height) - 1;
+        int right = width / 2 + (y * width) / (2 * height);
+        for (int x = 0; x < width; x++) {
+            int lane = abs(x - left) <= width / 80 || abs(x - right) <= width / 80;
+            int base = lane ? 220 : 60 + (40 * y) / height;
+            int noise = rand() % 24 - 12;
+            struct pixel *p = &data[y * width + x];
+            p->r = frame_source_clamp(base + noise);
+            p->g = frame_source_clamp(base + noise / 2);
+            p->b = frame_source_clamp(base - noise);
+        }
+    }
+}
+
+static struct pixel *load_bmp(const char *path, int *height, int *width) {
+    // Sized from the header, unlike read_bmp(), so the 720x540 images load too
+    struct bmp_view view;
+    if (bmp_view_open(path, &view) != 0) return NULL;
+    *width = view.width;
+    *height = view.height;
+    struct pixel *data = malloc(sizeof(struct pixel) * view.height * view.width);
+    if (data) bmp_view_copy(&view, data);
+    bmp_view_close(&view);
+    return data;
+}
+
+// Per-stage timing
+//  Every stage gets its inputs from one untimed run of the pipeline, then runs BENCH_WARMUP
+//  untimed and `iterations` timed calls. Stage stdout (the golden model's diagnostics) goes to
+//  /dev/null so the CSV on the original stdout stays clean.
+struct bench_frame {
+    const char *name;
+    int height;
+    int width;
+    struct pixel *rgb;
+    unsigned char *grayscale, *blurred, *edges, *nms, *thresholded, *roi, *scratch;
+    unsigned int *accumulator;
+    struct hough_lut *lut;
+    struct edge_stream *stream;
+    struct edge_bitmap *edge_bits;
+    int rho_indices[TOP_N], theta_indices[TOP_N], vote_counts[TOP_N];
+    int edge_pixels;
+};
+
+static void bench_stage(struct bench_frame *fr, int stage) {
+    int h = fr->height;
+    int w = fr->width;
+    int lr, lt, rr, rt;
+    switch (stage) {
+    case 0:  convert_to_grayscale(fr->rgb, h, w, fr->scratch); break;
+    case 1:  gaussian_blur(fr->grayscale, h, w, fr->scratch); break;
+    case 2:  gaussian_blur_separable(fr->grayscale, h, w, fr->scratch); break;
+    case 3:  sobel_filter(fr->blurred, h, w, fr->scratch); break;
+    case 4:  sobel_filter_fast(fr->blurred, h, w, fr->scratch, NULL); break;
+    case 5:  non_maximum_suppressor(fr->edges, h, w, fr->scratch); break;
+    case 6:  hysteresis_filter(fr->nms, h, w, fr->scratch); break;
+    case 7:  region_of_interest(fr->thresholded, h, w, fr->scratch); break;
+    case 8:  hough_transform(fr->roi, h, w, fr->accumulator); break;
+    case 9:  hough_transform_lut(fr->lut, fr->roi, fr->accumulator); break;
+    case 10: extract_top_lines(fr->accumulator, fr->lut->rhos, fr->rho_indices, fr->theta_indices, fr->vote_counts); break;
+    case 11: extract_top_lines_fast(fr->accumulator, fr->lut->rhos, 0, 0, fr->rho_indices, fr->theta_indices, fr->vote_counts); break;
+    case 12: calculate_center_lane(fr->scratch, h, w, fr->rho_indices, fr->theta_indices, fr->vote_counts, &lr, &lt, &rr, &rt); break;
+    case 13: edge_stream_frame(fr->stream, fr->rgb, NULL, fr->accumulator); break;
+    case 14: edge_bitmap_pack(fr->edge_bits, fr->roi); break;
+    case 15: hough_transform_bitmap(fr->lut, fr->edge_bits, fr->accumulator); break;
+    }
+}
+
+static const char *bench_stage_names[] = {
+    "convert_to_grayscale", "gaussian_blur", "gaussian_blur_separable", "sobel_filter", "sobel_filter_fast",
+    "non_maximum_suppressor", "hysteresis_filter", "region_of_interest", "hough_transform", "hough_transform_lut",
+    "extract_top_lines", "extract_top_lines_fast", "calculate_center_lane", "edge_stream_frame",
+    "edge_bitmap_pack", "hough_transform_bitmap"
+};
+
+static int bench_frame_init(struct bench_frame *fr, const char *name, struct pixel *rgb, int height, int width) {
+    size_t size = (size_t)height * width;
+    fr->name = name;
+    fr->height = height;
+    fr->width = width;
+    fr->rgb = rgb;
+    fr->grayscale = malloc(size);
+    fr->blurred = malloc(size);
+    fr->edges = malloc(size);
+    fr->nms = malloc(size);
+    fr->thresholded = malloc(size);
+    fr->roi = malloc(size);
+    fr->scratch = malloc(size);
+    fr->accumulator = malloc(sizeof(unsigned int) * hough_rhos(height, width) * THETAS);
+    fr->lut = hough_lut_create(height, width);
+    fr->stream = edge_stream_create(height, width);
+    fr->edge_bits = edge_bitmap_create(height, width);
+    if (!fr->grayscale || !fr->blurred || !fr->edges || !fr->nms || !fr->thresholded || !fr->roi ||
+        !fr->scratch || !fr->accumulator || !fr->lut || !fr->stream || !fr->edge_bits) {
+        return -1;
+    }
+
+    convert_to_grayscale(fr->rgb, height, width, fr->grayscale);
+    gaussian_blur_separable(fr->grayscale, height, width, fr->blurred);
+    sobel_filter_fast(fr->blurred, height, width, fr->edges, NULL);
+    non_maximum_suppressor(fr->edges, height, width, fr->nms);
+    hysteresis_filter(fr->nms, height, width, fr->thresholded);
+    region_of_interest(fr->thresholded, height, width, fr->roi);
+    hough_transform_lut(fr->lut, fr->roi, fr->accumulator);
+    edge_bitmap_pack(fr->edge_bits, fr->roi);
+    extract_top_lines_fast(fr->accumulator, fr->lut->rhos, 0, 0, fr->rho_indices, fr->theta_indices, fr->vote_counts);
+    memcpy(fr->scratch, fr->roi, size);
+
+    fr->edge_pixels = 0;
+    for (size_t i = 0; i < size; i++) {
+        fr->edge_pixels += fr->roi[i] != 0;
+    }
+    return 0;
+}
+
+static void bench_frame_free(struct bench_frame *fr) {
+    free(fr->rgb);
+    free(fr->grayscale);
+    free(fr->blurred);
+    free(fr->edges);
+    free(fr->nms);
+    free(fr->thresholded);
+    free(fr->roi);
+    free(fr->scratch);
+    free(fr->accumulator);
+    hough_lut_destroy(fr->lut);
+    edge_stream_destroy(fr->stream);
+    edge_bitmap_destroy(fr->edge_bits);
+}
+
+static void bench_frame_stages(FILE *csv, struct bench_frame *fr, int iterations) {
+    int pixels = fr->height * fr->width;
+    if (iterations <= 0) iterations = BENCH_PIXELS_PER_STAGE / pixels + 10;
+    double *samples = malloc(sizeof(double) * iterations);
+    if (!samples) exit(1);
+
+    for (size_t stage = 0; stage < sizeof bench_stage_names / sizeof bench_stage_names[0]; stage++) {
+        for (int i = 0; i < BENCH_WARMUP; i++) {
+            bench_stage(fr, stage);
+        }
+        for (int i = 0; i < iterations; i++) {
+            double start = now_ns();
+            bench_stage(fr, stage);
+            samples[i] = now_ns() - start;
+        }
+        fflush(stdout);
+
+        qsort(samples, iterations, sizeof(double), compare_double);
+        double median = samples[iterations / 2];
+        fprintf(csv, "%s,%d,%d,%d,%s,%d,%.3f,%.2f,%.1f,%.1f,%.1f\n", fr->name, fr->width, fr->height, fr->edge_pixels,
+                bench_stage_names[stage], iterations, median / pixels, pixels / (median / 1e3),
+                samples[0] / 1e3, median / 1e3, samples[(iterations * 99) / 100] / 1e3);
+        fflush(csv);
+    }
+    free(samples);
+}
+
+static void bench_stages(const char *image_dir, int iterations) {
+/**
+    * @brief Times every pipeline stage over the corpus images and synthetic frames.
+    *
+    * Writes one CSV row per (frame, stage) with ns/pixel, MPix/s and min/median/p99 latency.
+*/
+    // Keep the CSV on the real stdout and send stage diagnostics to /dev/null
+    FILE *csv = fdopen(dup(fileno(stdout)), "w");
+    if (!csv || !freopen("/dev/null", "w", stdout)) {
+        fprintf(stderr, "Error: Failed to redirect stage output\n");
+        exit(1);
+    }
+    fprintf(csv, "frame,width,height,edge_pixels,stage,iterations,ns_per_pixel,mpix_per_s,min_us,median_us,p99_us\n");
+
+    struct dirent **entries;
+    int n = scandir(image_dir, &entries, frame_source_bmp_filter, alphasort);
+    for (int i = 0; i < n; i++) {
+        char *path = malloc(strlen(image_dir) + strlen(entries[i]->d_name) + 2);
+        sprintf(path, "%s/%s", image_dir, entries[i]->d_name);
+        struct bench_frame fr;
+        int height, width;
+        struct pixel *rgb = load_bmp(path, &height, &width);
+        if (rgb && bench_frame_init(&fr, entries[i]->d_name, rgb, height, width) == 0) {
+            bench_frame_stages(csv, &fr, iterations);
+            bench_frame_free(&fr);
+        } else {
+            fprintf(stderr, "Error: Skipping %s\n", path);
+            free(rgb);
+        }
+        free(path);
+        free(entries[i]);
+    }
+    if (n >= 0) free(entries);
+
+    srand(BENCH_SEED);
+    for (size_t s = 0; s < sizeof bench_sizes / sizeof bench_sizes[0]; s++) {
+        int height = bench_sizes[s][0];
+        int width = bench_sizes[s][1];
+        char name[32];
+        snprintf(name, sizeof name, "synthetic_%dx%d", width, height);
+        struct bench_frame fr;
+        struct pixel *rgb = malloc(sizeof(struct pixel) * height * width);
+        if (!rgb) exit(1);
+        synth_frame(rgb, height, width);
+        if (bench_frame_init(&fr, name, rgb, height, width) != 0) exit(1);
+        bench_frame_stages(csv, &fr, iterations);
+        bench_frame_free(&fr);
+    }
+    fclose(csv);
+}
+
+static void bench_hough_scaling(int max_threads) {
+/**
+    * @brief Times hough_transform_parallel() from 1 to max_threads threads.
+    *
+    * Every run is checked against the single-threaded accumulator.
+*/
+    printf("width,height,edge_pixels,threads,median_us,speedup\n");
+    for (size_t s = 0; s < sizeof bench_sizes / sizeof bench_sizes[0]; s++) {
+        int height = bench_sizes[s][0];
+        int width = bench_sizes[s][1];
+        int iterations = 20000000 / (height * width) + 10;
+
+        unsigned char *edges = malloc((size_t)height * width);
+        size_t accum_size = sizeof(unsigned int) * hough_rhos(height, width) * THETAS;
+        unsigned int *reference = malloc(accum_size);
+        unsigned int *accumulator = malloc(accum_size);
+        double *samples = malloc(sizeof(double) * iterations);
+        struct hough_lut *lut = hough_lut_create(height, width);
+        if (!edges || !reference || !accumulator || !samples || !lut) {
+            fprintf(stderr, "Error: Failed to allocate benchmark buffers\n");
+            exit(1);
+        }
+
+        srand(BENCH_SEED);
+        int edge_pixels = synth_edges(edges, height, width, 20);
+        double baseline = 0.0;
+
+        for (int threads = 1; threads <= max_threads; threads++) {
+            struct hough_pool *pool = hough_pool_create(lut, threads);
+            if (!pool) exit(1);
+
+            for (int i = 0; i < BENCH_WARMUP; i++) {
+                hough_transform_parallel(pool, edges, accumulator);
+            }
+            for (int i = 0; i < iterations; i++) {
+                double start = now_ns();
+                hough_transform_parallel(pool, edges, accumulator);
+                samples[i] = now_ns() - start;
+            }
+            hough_pool_destroy(pool);
+
+            if (threads == 1) {
+                memcpy(reference, accumulator, accum_size);
+            } else if (memcmp(reference, accumulator, accum_size) != 0) {
+                fprintf(stderr, "Error: %d-thread accumulator differs from the serial result\n", threads);
+                exit(1);
+            }
+
+            qsort(samples, iterations, sizeof(double), compare_double);
+            double median = samples[iterations / 2];
+            if (threads == 1) baseline = median;
+            printf("%d,%d,%d,%d,%.1f,%.2f\n", width, height, edge_pixels, threads, median / 1e3, baseline / median);
+        }
+
+        hough_lut_destroy(lut);
+        free(edges);
+        free(reference);
+        free(accumulator);
+        free(samples);
+    }
+}
+
+static void bench_band_scaling(int max_threads) {
+/**
+    * @brief Times edge_bands_frame() on a synthetic road frame from 1 to max_threads bands.
+    *
+    * The serial stream is timed first as the baseline, and every run is checked against its
+    * accumulator and ROI edge map.
+*/
+    printf("width,height,edge_pixels,bands,median_us,speedup\n");
+    for (size_t s = 0; s < sizeof bench_sizes / sizeof bench_sizes[0]; s++) {
+        int height = bench_sizes[s][0];
+        int width = bench_sizes[s][1];
+        int iterations = 20000000 / (height * width) + 10;
+
+        struct pixel *rgb = malloc(sizeof(struct pixel) * height * width);
+        unsigned char *reference_edges = malloc((size_t)height * width);
+        unsigned char *edges = malloc((size_t)height * width);
+        size_t accum_size = sizeof(unsigned int) * hough_rhos(height, width) * THETAS;
+        unsigned int *reference = malloc(accum_size);
+        unsigned int *accumulator = malloc(accum_size);
+        double *samples = malloc(sizeof(double) * iterations);
+        struct edge_stream *stream = edge_stream_create(height, width);
+        if (!rgb || !reference_edges || !edges || !reference || !accumulator || !samples || !stream) {
+            fprintf(stderr, "Error: Failed to allocate benchmark buffers\n");
+            exit(1);
+        }
+
+        srand(BENCH_SEED);
+        synth_frame(rgb, height, width);
+        const unsigned char *pixels = (const unsigned char *)rgb;
+        ptrdiff_t stride = (ptrdiff_t)width * sizeof(struct pixel);
+        int edge_pixels = 0;
+        double baseline = 0.0;
+
+        // bands == 0 is the serial stream
+        for (int bands = 0; bands <= max_threads; bands++) {
+            struct edge_bands *pool = bands > 0 ? edge_bands_create(height, width, bands) : NULL;
+            if (bands > 0 && !pool) exit(1);
+
+            for (int i = 0; i < BENCH_WARMUP + iterations; i++) {
+                double start = now_ns();
+                int res = pool ? edge_bands_frame(pool, stream, pixels, stride, -1, edges, accumulator)
+                               : edge_stream_frame_strided(stream, pixels, stride, edges, accumulator);
+                if (res != 0) exit(1);
+                if (i >= BENCH_WARMUP) samples[i - BENCH_WARMUP] = now_ns() - start;
+            }
+            int used = pool ? pool->bands : 0;
+            edge_bands_destroy(pool);
+            if (used > 0 && used < bands) break; // Frame too short for more bands
+
+            if (!pool) {
+                memcpy(reference, accumulator, accum_size);
+                memcpy(reference_edges, edges, (size_t)height * width);
+                for (int i = 0; i < height * width; i++) edge_pixels += edges[i] != 0;
+            } else if (memcmp(reference, accumulator, accum_size) != 0 || memcmp(reference_edges, edges, (size_t)height * width) != 0) {
+                fprintf(stderr, "Error: %d-band output differs from the serial stream\n", bands);
+                exit(1);
+            }
+
+            qsort(samples, iterations, sizeof(double), compare_double);
+            double median = samples[iterations / 2];
+            if (!pool) baseline = median;
+            printf("%d,%d,%d,%d,%.1f,%.2f\n", width, height, edge_pixels, bands, median / 1e3, baseline / median);
+        }
+
+        edge_stream_destroy(stream);
+        free(rgb);
+        free(reference_edges);
+        free(edges);
+        free(reference);
+        free(accumulator);
+        free(samples);
+    }
+}
+
+static void bench_roi(void) {
+/**
+    * @brief Times the streaming pipeline with each kind of ROI, computing whole frames and
+    *        skipping what cannot reach the ROI.
+    *
+    * Every skipping run is checked against the whole-frame accumulator and ROI edge map.
+*/
+    printf("width,height,roi,edge_pixels,whole_us,skip_us,speedup\n");
+    for (size_t s = 0; s < sizeof bench_sizes / sizeof bench_sizes[0]; s++) {
+        int height = bench_sizes[s][0];
+        int width = bench_sizes[s][1];
+        int iterations = 20000000 / (height * width) + 10;
+
+        // The default, a lower band and a trapezoid over the road
+        struct lanedetect_roi rois[3] = { { LANEDETECT_ROI_DEFAULT } };
+        const char *names[3] = { "default", "rows", "trapezoid" };
+        rois[1].kind = LANEDETECT_ROI_ROWS;
+        rois[1].row_begin = height / 8;
+        rois[1].row_end = height / 2;
+        rois[2].kind = LANEDETECT_ROI_TRAPEZOID;
+        rois[2].row_begin = 0;
+        rois[2].row_end = height / 2;
+        rois[2].bottom_left = 0;
+        rois[2].bottom_right = width;
+        rois[2].top_left = width * 3 / 8;
+        rois[2].top_right = width * 5 / 8;
+
+        struct pixel *rgb = malloc(sizeof(struct pixel) * height * width);
+        unsigned char *reference_edges = malloc((size_t)height * width);
+        unsigned char *edges = malloc((size_t)height * width);
+        size_t accum_size = sizeof(unsigned int) * hough_rhos(height, width) * THETAS;
+        unsigned int *reference = malloc(accum_size);
+        unsigned int *accumulator = malloc(accum_size);
+        double *samples = malloc(sizeof(double) * iterations);
+        struct edge_stream *stream = edge_stream_create(height, width);
+        if (!rgb || !reference_edges || !edges || !reference || !accumulator || !samples || !stream) {
+            fprintf(stderr, "Error: Failed to allocate benchmark buffers\n");
+            exit(1);
+        }
+
+        srand(BENCH_SEED);
+        synth_frame(rgb, height, width);
+        const unsigned char *pixels = (const unsigned char *)rgb;
+        ptrdiff_t stride = (ptrdiff_t)width * sizeof(struct pixel);
+
+        for (int r = 0; r < 3; r++) {
+            double median[2];
+            int edge_pixels = 0;
+            for (int skip = 0; skip < 2; skip++) {
+                if (edge_stream_set_roi(stream, &rois[r], skip) != 0) exit(1);
+                for (int i = 0; i < BENCH_WARMUP + iterations; i++) {
+                    double start = now_ns();
+                    if (edge_stream_frame_strided(stream, pixels, stride, edges, accumulator) != 0) exit(1);
+                    if (i >= BENCH_WARMUP) samples[i - BENCH_WARMUP] = now_ns() - start;
+                }
+                if (!skip) {
+                    memcpy(reference, accumulator, accum_size);
+                    memcpy(reference_edges, edges, (size_t)height * width);
+                    for (int i = 0; i < height * width; i++) edge_pixels += edges[i] != 0;
+                } else if (memcmp(reference, accumulator, accum_size) != 0 || memcmp(reference_edges, edges, (size_t)height * width) != 0) {
+                    fprintf(stderr, "Error: Skipping with the %s ROI changes the output\n", names[r]);
+                    exit(1);
+                }
+                qsort(samples, iterations, sizeof(double), compare_double);
+                median[skip] = samples[iterations / 2];
+            }
+            printf("%d,%d,%s,%d,%.1f,%.1f,%.2f\n", width, height, names[r], edge_pixels, median[0] / 1e3, median[1] / 1e3, median[0] / median[1]);
+        }
+
+        edge_stream_destroy(stream);
+        free(rgb);
+        free(reference_edges);
+        free(edges);
+        free(reference);
+        free(accumulator);
+        free(samples);
+    }
+}
+
+// Coarse-to-fine Hough
+//  Every frame is voted by hough_transform(), hough_transform_bitmap() and hough_transform_coarse()
+//  at a few resolutions. The coarse lanes and steering are compared with the flat transform's,
+//  and every cell the coarse transform voted is checked against the flat accumulator.
+static const int bench_coarse_settings[][4] = {  // theta_step, rho_log, candidates, margin
+    { 6, 2, 2, 2 },  // 6 degrees by 16 pixels
+    { HOUGH_COARSE_THETA_STEP, HOUGH_COARSE_RHO_LOG, HOUGH_COARSE_CANDIDATES, HOUGH_COARSE_MARGIN },
+    { 6, 1, 3, 2 },  // 6 degrees by 8 pixels
+    { 2, 0, 3, 2 },
+};
+
+static double bench_coarse_time(struct bench_frame *fr, struct hough_coarse *hc, int iterations, double *samples) {
+    // Median microseconds of hough_transform() (hc NULL, iterations > 0), hough_transform_bitmap()
+    // (hc NULL, iterations < 0) or hough_transform_coarse()
+    int n = iterations < 0 ? -iterations : iterations;
+    for (int i = 0; i < BENCH_WARMUP + n; i++) {
+        double start = now_ns();
+        if (hc) {
+            hough_transform_coarse(hc, fr->edge_bits, fr->accumulator);
+        } else if (iterations > 0) {
+            hough_transform(fr->roi, fr->height, fr->width, fr->accumulator);
+        } else {
+            hough_transform_bitmap(fr->lut, fr->edge_bits, fr->accumulator);
+        }
+        if (i >= BENCH_WARMUP) samples[i - BENCH_WARMUP] = now_ns() - start;
+    }
+    qsort(samples, n, sizeof(double), compare_double);
+    return samples[n / 2] / 1e3;
+}
+
+static void bench_coarse_frame(struct bench_frame *fr, int *same_lanes, int *same_steering) {
+    int n_settings = sizeof bench_coarse_settings / sizeof bench_coarse_settings[0];
+    int iterations = 20000000 / (fr->height * fr->width) + 10;
+    int rhos = fr->lut->rhos;
+    unsigned int *flat = malloc(sizeof(unsigned int) * rhos * THETAS);
+    double *samples = malloc(sizeof(double) * iterations);
+    if (!flat || !samples) exit(1);
+
+    struct lanedetect_result reference, result;
+    hough_transform(fr->roi, fr->height, fr->width, flat);
+    extract_top_lines(flat, rhos, fr->rho_indices, fr->theta_indices, fr->vote_counts);
+    lane_steering(fr->height, fr->width, ROI_DEFAULT_ROWS(fr->height), fr->rho_indices, fr->theta_indices, fr->vote_counts, &reference);
+    double flat_us = bench_coarse_time(fr, NULL, iterations, samples);
+    double bitmap_us = bench_coarse_time(fr, NULL, -iterations, samples);
+
+    for (int i = 0; i < n_settings; i++) {
+        const int *cfg = bench_coarse_settings[i];
+        struct hough_coarse *hc = hough_coarse_create(fr->lut, cfg[0], cfg[1], cfg[2], cfg[3]);
+        if (!hc) exit(1);
+        hough_transform_coarse(hc, fr->edge_bits, fr->accumulator);
+        for (int c = 0; c < rhos * THETAS; c++) {
+            if (fr->accumulator[c] != 0 && fr->accumulator[c] != flat[c]) {
+                fprintf(stderr, "Error: Coarse-to-fine cell rho %d, theta %d of %s differs from hough_transform()\n", c / THETAS, c % THETAS, fr->name);
+                exit(1);
+            }
+        }
+        extract_top_lines(fr->accumulator, rhos, fr->rho_indices, fr->theta_indices, fr->vote_counts);
+        lane_steering(fr->height, fr->width, ROI_DEFAULT_ROWS(fr->height), fr->rho_indices, fr->theta_indices, fr->vote_counts, &result);
+        int lanes = result.left_rho_idx == reference.left_rho_idx && result.left_theta_idx == reference.left_theta_idx &&
+                    result.right_rho_idx == reference.right_rho_idx && result.right_theta_idx == reference.right_theta_idx;
+        int steering = result.status == reference.status && result.steering == reference.steering;
+        same_lanes[i] += lanes;
+        same_steering[i] += steering;
+
+        double work = (double)(hc->coarse_votes + hc->fine_votes) / ((double)fr->edge_pixels * fr->lut->n_thetas);
+        double coarse_us = bench_coarse_time(fr, hc, iterations, samples);
+        printf("%s,%d,%d,%d,%d,%d,%d,%d,%.1f,%.1f,%.1f,%.2f,%.2f,%.3f,%d,%d\n", fr->name, fr->width, fr->height, fr->edge_pixels,
+               cfg[0], (1 << cfg[1]) * RHO_RESOLUTION, cfg[2], cfg[3], flat_us, bitmap_us, coarse_us, flat_us / coarse_us,
+               bitmap_us / coarse_us, work, lanes, steering);
+        hough_coarse_destroy(hc);
+    }
+    free(flat);
+    free(samples);
+}
+
+static void bench_coarse(const char *image_dir) {
+/**
+    * @brief Times the coarse-to-fine Hough transform against the flat transforms on the corpus
+    *        images and synthetic frames, and counts the frames whose lanes and steering match.
+*/
+    int n_settings = sizeof bench_coarse_settings / sizeof bench_coarse_settings[0];
+    int same_lanes[sizeof bench_coarse_settings / sizeof bench_coarse_settings[0]] = { 0 };
+    int same_steering[sizeof bench_coarse_settings / sizeof bench_coarse_settings[0]] = { 0 };
+    int frames = 0;
+    printf("frame,width,height,edge_pixels,theta_step,rho_pixels,candidates,margin,flat_us,bitmap_us,coarse_us,"
+           "speedup_flat,speedup_bitmap,work,same_lanes,same_steering\n");
+
+    struct dirent **entries;
+    int n = scandir(image_dir, &entries, frame_source_bmp_filter, alphasort);
+    for (int i = 0; i < n; i++) {
+        char *path = malloc(strlen(image_dir) + strlen(entries[i]->d_name) + 2);
+        sprintf(path, "%s/%s", image_dir, entries[i]->d_name);
+        struct bench_frame fr;
+        int height, width;
+        struct pixel *rgb = load_bmp(path, &height, &width);
+        if (rgb && bench_frame_init(&fr, entries[i]->d_name, rgb, height, width) == 0) {
+            bench_coarse_frame(&fr, same_lanes, same_steering);
+            bench_frame_free(&fr);
+            frames++;
+        } else {
+            fprintf(stderr, "Error: Skipping %s\n", path);
+            free(rgb);
+        }
+        free(path);
+        free(entries[i]);
+    }
+    if (n >= 0) free(entries);
+
+    srand(BENCH_SEED);
+    for (size_t s = 0; s < sizeof bench_sizes / sizeof bench_sizes[0]; s++) {
+        int height = bench_sizes[s][0];
+        int width = bench_sizes[s][1];
+        char name[32];
+        snprintf(name, sizeof name, "synthetic_%dx%d", width, height);
+        struct bench_frame fr;
+        struct pixel *rgb = malloc(sizeof(struct pixel) * height * width);
+        if (!rgb) exit(1);
+        synth_frame(rgb, height, width);
+        if (bench_frame_init(&fr, name, rgb, height, width) != 0) exit(1);
+        bench_coarse_frame(&fr, same_lanes, same_steering);
+        bench_frame_free(&fr);
+        frames++;
+    }
+
+    for (int i = 0; i < n_settings; i++) {
+        const int *cfg = bench_coarse_settings[i];
+        fprintf(stderr, "%d degrees by %d pixels, %d candidates, margin %d: same lanes on %d of %d frames, same steering on %d\n",
+                cfg[0], (1 << cfg[1]) * RHO_RESOLUTION, cfg[2], cfg[3], same_lanes[i], frames, same_steering[i]);
+    }
+}
+
+// Progressive Hough
+//  Every frame is voted by hough_transform_progressive() with BENCH_PROGRESSIVE_SEEDS seeds at a
+//  few vote budgets, given as a percentage of the frame's exhaustive votes. The pixels voted and
+//  the frames whose lanes and steering differ from hough_transform() are counted over the seeds.
+#define BENCH_PROGRESSIVE_SEEDS 32
+
+static const int bench_progressive_budgets[] = { 0, 75, 50, 25 };  // Percent of the exhaustive votes, 0 for none
+
+static double bench_progressive_time(struct bench_frame *fr, struct hough_progressive *hp, int iterations, double *samples) {
+    // Median microseconds of hough_transform_bitmap() (hp NULL) or hough_transform_progressive()
+    for (int i = 0; i < BENCH_WARMUP + iterations; i++) {
+        double start = now_ns();
+        if (hp) {
+            hough_transform_progressive(hp, fr->edge_bits, fr->accumulator);
+        } else {
+            hough_transform_bitmap(fr->lut, fr->edge_bits, fr->accumulator);
+        }
+        if (i >= BENCH_WARMUP) samples[i - BENCH_WARMUP] = now_ns() - start;
+    }
+    qsort(samples, iterations, sizeof(double), compare_double);
+    return samples[iterations / 2] / 1e3;
+}
+
+static void bench_progressive_frame(struct bench_frame *fr, int *runs, int *same_lanes, int *same_steering, long long *voted, long long *edges) {
+    int n_budgets = sizeof bench_progressive_budgets / sizeof bench_progressive_budgets[0];
+    int iterations = 20000000 / (fr->height * fr->width) + 10;
+    int rhos = fr->lut->rhos;
+    double *samples = malloc(sizeof(double) * iterations);
+    if (!samples) exit(1);
+
+    struct lanedetect_result reference, result;
+    hough_transform(fr->roi, fr->height, fr->width, fr->accumulator);
+    extract_top_lines(fr->accumulator, rhos, fr->rho_indices, fr->theta_indices, fr->vote_counts);
+    lane_steering(fr->height, fr->width, ROI_DEFAULT_ROWS(fr->height), fr->rho_indices, fr->theta_indices, fr->vote_counts, &reference);
+    double bitmap_us = bench_progressive_time(fr, NULL, iterations, samples);
+
+    for (int b = 0; b < n_budgets; b++) {
+        int max_votes = (int)((long long)fr->edge_pixels * fr->lut->n_thetas * bench_progressive_budgets[b] / 100);
+        if (bench_progressive_budgets[b] > 0 && max_votes < fr->lut->n_thetas) max_votes = fr->lut->n_thetas;
+        int frame_voted = 0, budget_stops = 0, lanes = 0, steering = 0;
+        for (int s = 1; s <= BENCH_PROGRESSIVE_SEEDS; s++) {
+            struct hough_progressive *hp = hough_progressive_create(fr->lut, (uint32_t)s * HOUGH_PROGRESSIVE_SEED, max_votes, 0);
+            if (!hp) exit(1);
+            hough_transform_progressive(hp, fr->edge_bits, fr->accumulator);
+            extract_top_lines(fr->accumulator, rhos, fr->rho_indices, fr->theta_indices, fr->vote_counts);
+            lane_steering(fr->height, fr->width, ROI_DEFAULT_ROWS(fr->height), fr->rho_indices, fr->theta_indices, fr->vote_counts, &result);
+            lanes += result.left_rho_idx == reference.left_rho_idx && result.left_theta_idx == reference.left_theta_idx &&
+                     result.right_rho_idx == reference.right_rho_idx && result.right_theta_idx == reference.right_theta_idx;
+            steering += result.status == reference.status && result.steering == reference.steering;
+            frame_voted += hp->voted_pixels;
+            budget_stops += hp->stop == HOUGH_PROGRESSIVE_BUDGET;
+            hough_progressive_destroy(hp);
+        }
+        runs[b] += BENCH_PROGRESSIVE_SEEDS;
+        same_lanes[b] += lanes;
+        same_steering[b] += steering;
+        voted[b] += frame_voted;
+        edges[b] += (long long)fr->edge_pixels * BENCH_PROGRESSIVE_SEEDS;
+
+        struct hough_progressive *hp = hough_progressive_create(fr->lut, 0, max_votes, 0);
+        if (!hp) exit(1);
+        double progressive_us = bench_progressive_time(fr, hp, iterations, samples);
+        hough_progressive_destroy(hp);
+        printf("%s,%d,%d,%d,%d,%d,%d,%.1f,%d,%d,%d,%.1f,%.1f,%.2f\n", fr->name, fr->width, fr->height, fr->edge_pixels,
+               bench_progressive_budgets[b], max_votes, BENCH_PROGRESSIVE_SEEDS, (double)frame_voted / BENCH_PROGRESSIVE_SEEDS,
+               budget_stops, lanes, steering, bitmap_us, progressive_us, bitmap_us / progressive_us);
+    }
+    free(samples);
+}
+
+static void bench_progressive(const char *image_dir) {
+/**
+    * @brief Measures the pixels the progressive Hough transform votes and how often its lanes and
+    *        steering differ from exhaustive voting, on the corpus images and synthetic frames.
+*/
+    int n_budgets = sizeof bench_progressive_budgets / sizeof bench_progressive_budgets[0];
+    int runs[sizeof bench_progressive_budgets / sizeof bench_progressive_budgets[0]] = { 0 };
+    int same_lanes[sizeof bench_progressive_budgets / sizeof bench_progressive_budgets[0]] = { 0 };
+    int same_steering[sizeof bench_progressive_budgets / sizeof bench_progressive_budgets[0]] = { 0 };
+    long long voted[sizeof bench_progressive_budgets / sizeof bench_progressive_budgets[0]] = { 0 };
+    long long edges[sizeof bench_progressive_budgets / sizeof bench_progressive_budgets[0]] = { 0 };
+    printf("frame,width,height,edge_pixels,budget_percent,max_votes,seeds,voted_pixels,budget_stops,same_lanes,"
+           "same_steering,bitmap_us,progressive_us,speedup\n");
+
+    struct dirent **entries;
+    int n = scandir(image_dir, &entries, frame_source_bmp_filter, alphasort);
+    for (int i = 0; i < n; i++) {
+        char *path = malloc(strlen(image_dir) + strlen(entries[i]->d_name) + 2);
+        sprintf(path, "%s/%s", image_dir, entries[i]->d_name);
+        struct bench_frame fr;
+        int height, width;
+        struct pixel *rgb = load_bmp(path, &height, &width);
+        if (rgb && bench_frame_init(&fr, entries[i]->d_name, rgb, height, width) == 0) {
+            bench_progressive_frame(&fr, runs, same_lanes, same_steering, voted, edges);
+            bench_frame_free(&fr);
+        } else {
+            fprintf(stderr, "Error: Skipping %s\n", path);
+            free(rgb);
+        }
+        free(path);
+        free(entries[i]);
+    }
+    if (n >= 0) free(entries);
+
+    srand(BENCH_SEED);
+    for (size_t s = 0; s < sizeof bench_sizes / sizeof bench_sizes[0]; s++) {
+        int height = bench_sizes[s][0];
+        int width = bench_sizes[s][1];
+        char name[32];
+        snprintf(name, sizeof name, "synthetic_%dx%d", width, height);
+        struct bench_frame fr;
+        struct pixel *rgb = malloc(sizeof(struct pixel) * height * width);
+        if (!rgb) exit(1);
+        synth_frame(rgb, height, width);
+        if (bench_frame_init(&fr, name, rgb, height, width) != 0) exit(1);
+        bench_progressive_frame(&fr, runs, same_lanes, same_steering, voted, edges);
+        bench_frame_free(&fr);
+    }
+
+    for (int b = 0; b < n_budgets; b++) {
+        fprintf(stderr, "Budget %d%%: %.1f%% of the edge pixels voted, same lanes in %d of %d runs, same steering in %d\n",
+                bench_progressive_budgets[b], edges[b] ? 100.0 * voted[b] / edges[b] : 0.0, same_lanes[b], runs[b], same_steering[b]);
+    }
+}
+
+// Accumulator layout
+//  Every frame is voted and its peaks extracted the way a context did before the band accumulator
+//  (hough_transform_bitmap(), which clears a rho-major 16-bit buffer and copies it out, then
+//  hough_accumulator_stats() and extract_top_lines_fast()) and with the theta-major band
+//  accumulator (hough_band_accum_clear(), hough_band_accum_vote_bitmap(), hough_band_accum_stats()
+//  and extract_top_lines_band()). The peaks must be identical for every flag combination.
+static double bench_layout_time(struct bench_frame *fr, struct hough_band_accum *acc, int iterations, double *samples) {
+    // Median microseconds of a frame with the rho-major accumulator (acc NULL) or the band accumulator
+    int saturated;
+    for (int i = 0; i < BENCH_WARMUP + iterations; i++) {
+        double start = now_ns();
+        if (acc) {
+            hough_band_accum_clear(acc);
+            hough_band_accum_vote_bitmap(acc, fr->edge_bits);
+            hough_band_accum_stats(acc, &saturated);
+            extract_top_lines_band(acc, 0, 0, fr->rho_indices, fr->theta_indices, fr->vote_counts);
+        } else {
+            hough_transform_bitmap(fr->lut, fr->edge_bits, fr->accumulator);
+            hough_accumulator_stats(fr->accumulator, fr->lut->rhos, &saturated);
+            extract_top_lines_fast(fr->accumulator, fr->lut->rhos, 0, 0, fr->rho_indices, fr->theta_indices, fr->vote_counts);
+        }
+        if (i >= BENCH_WARMUP) samples[i - BENCH_WARMUP] = now_ns() - start;
+    }
+    qsort(samples, iterations, sizeof(double), compare_double);
+    return samples[iterations / 2] / 1e3;
+}
+
+static int bench_layout_frame(struct bench_frame *fr) {
+    int iterations = 20000000 / (fr->height * fr->width) + 10;
+    int rhos = fr->lut->rhos;
+    double *samples = malloc(sizeof(double) * iterations);
+    struct hough_band_accum *acc = hough_band_accum_create(fr->lut);
+    if (!samples || !acc) exit(1);
+
+    int same = 1;
+    hough_transform_bitmap(fr->lut, fr->edge_bits, fr->accumulator);
+    hough_band_accum_vote_bitmap(acc, fr->edge_bits);
+    for (int flags = 0; flags <= (PEAKS_LOCAL_MAX | PEAKS_PER_LANE); flags++) {
+        int rho_indices[TOP_N], theta_indices[TOP_N], vote_counts[TOP_N];
+        extract_top_lines_fast(fr->accumulator, rhos, 0, flags, fr->rho_indices, fr->theta_indices, fr->vote_counts);
+        extract_top_lines_band(acc, 0, flags, rho_indices, theta_indices, vote_counts);
+        same &= memcmp(rho_indices, fr->rho_indices, sizeof rho_indices) == 0 &&
+                memcmp(theta_indices, fr->theta_indices, sizeof theta_indices) == 0 &&
+                memcmp(vote_counts, fr->vote_counts, sizeof vote_counts) == 0;
+    }
+    int dirty_bins = 0;
+    for (int t = 0; t < fr->lut->n_thetas; t++) {
+        dirty_bins += acc->span_end[t] - acc->span_begin[t];
+    }
+
+    double rho_major_us = bench_layout_time(fr, NULL, iterations, samples);
+    double band_us = bench_layout_time(fr, acc, iterations, samples);
+    printf("%s,%d,%d,%d,%zu,%zu,%d,%d,%.1f,%.1f,%.2f,%d\n", fr->name, fr->width, fr->height, fr->edge_pixels,
+           (sizeof(unsigned short) + sizeof(unsigned int)) * rhos * THETAS, sizeof(unsigned short) * rhos * fr->lut->n_thetas,
+           dirty_bins, rhos * fr->lut->n_thetas, rho_major_us, band_us, rho_major_us / band_us, same);
+    hough_band_accum_destroy(acc);
+    free(samples);
+    return same;
+}
+
+static void bench_layout(const char *image_dir) {
+/**
+    * @brief Times the rho-major and theta-major band accumulators on the corpus images and
+    *        synthetic frames, and checks that both give the same peaks.
+*/
+    int frames = 0, same = 0;
+    printf("frame,width,height,edge_pixels,rho_major_bytes,band_bytes,dirty_bins,band_bins,rho_major_us,band_us,speedup,same_peaks\n");
+
+    struct dirent **entries;
+    int n = scandir(image_dir, &entries, frame_source_bmp_filter, alphasort);
+    for (int i = 0; i < n; i++) {
+        char *path = malloc(strlen(image_dir) + strlen(entries[i]->d_name) + 2);
+        sprintf(path, "%s/%s", image_dir, entries[i]->d_name);
+        struct bench_frame fr;
+        int height, width;
+        struct pixel *rgb = load_bmp(path, &height, &width);
+        if (rgb && bench_frame_init(&fr, entries[i]->d_name, rgb, height, width) == 0) {
+            same += bench_layout_frame(&fr);
+            bench_frame_free(&fr);
+            frames++;
+        } else {
+            fprintf(stderr, "Error: Skipping %s\n", path);
+            free(rgb);
+        }
+        free(path);
+        free(entries[i]);
+    }
+    if (n >= 0) free(entries);
+
+    srand(BENCH_SEED);
+    for (size_t s = 0; s < sizeof bench_sizes / sizeof bench_sizes[0]; s++) {
+        int height = bench_sizes[s][0];
+        int width = bench_sizes[s][1];
+        char name[32];
+        snprintf(name, sizeof name, "synthetic_%dx%d", width, height);
+        struct bench_frame fr;
+        struct pixel *rgb = malloc(sizeof(struct pixel) * height * width);
+        if (!rgb) exit(1);
+        synth_frame(rgb, height, width);
+        if (bench_frame_init(&fr, name, rgb, height, width) != 0) exit(1);
+        same += bench_layout_frame(&fr);
+        bench_frame_free(&fr);
+        frames++;
+    }
+    fprintf(stderr, "Same peaks on %d of %d frames\n", same, frames);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (strcmp(argv[1], "hough") == 0 || strcmp(argv[1], "bands") == 0)) {
+        int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (argc > 2) max_threads = atoi(argv[2]);
+        if (max_threads < 1) max_threads = 1;
+        if (argv[1][0] == 'h') {
+            bench_hough_scaling(max_threads);
+        } else {
+            bench_band_scaling(max_threads);
+        }
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "roi") == 0) {
+        bench_roi();
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "coarse") == 0) {
+        bench_coarse(argc > 2 ? argv[2] : "images");
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "progressive") == 0) {
+        bench_progressive(argc > 2 ? argv[2] : "images");
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "layout") == 0) {
+        bench_layout(argc > 2 ? argv[2] : "images");
+        return 0;
+    }
+
+    const char *image_dir = "images";
+    int iterations = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "stages") == 0) {
+            continue;
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else {
+            image_dir = argv[i];
+        }
+    }
+    bench_stages(image_dir, iterations);
+    return 0;
+}
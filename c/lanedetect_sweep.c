@@ -0,0 +1,641 @@
+// To compile: gcc -O2 lanedetect_sweep.c -o lanedetect_sweep -lm -lpthread
+// To run: ./lanedetect_sweep [--threads N] [--tolerance T] [--gradient] [image_dir | file.bmp ...]
+//
+// Design-space sweep over the Hough back end. The edge maps do not depend on the swept
+// parameters, so the golden front end (grayscale through ROI) runs once per image. Every design
+// point then rebuilds its Q-format sin/cos tables (what lanedetect_const.c/.py generate by hand)
+// and runs voting, top-N extraction and calculate_center_lane()'s lane selection and steering
+// with its own RHO_RESOLUTION, THETAS, TOP_N and BITS. Points are spread over all cores.
+//
+// Steering is compared against a float reference: 1-pixel rho bins, 1 degree thetas, exact
+// trigonometry and no quantization. The CSV on stdout has one row per point. The cheapest
+// point (by accumulator size, then votes per frame) that stays within --tolerance steering
+// units of the golden configuration's mean error and loses no more frames is reported on stderr.
+//
+// --gradient sweeps the k of gradient-constrained voting (see struct gradient_windows) with the
+// golden configuration instead, against full lane-band voting and the same float reference.
+// The smallest k within --tolerance of full voting that loses no more frames is reported.
+
+#define LANEDETECT_NO_MAIN
+#include "lanedetect.c"
+
+#include <unistd.h>
+
+#define SWEEP_MAX_TOP_N 32
+#define SWEEP_REF_TOP_N 16
+
+static const int sweep_rho_res_logs[] = { 0, 1, 2, 3 };
+static const int sweep_thetas[] = { 180, 90, 60, 45, 36 };
+static const int sweep_top_ns[] = { 4, 8, 16 };
+static const int sweep_bits[] = { 6, 7, 8, 10, 12, 14 };
+static const int sweep_gradient_ks[] = { 0, 1, 2, 3, 4, 5, 6, 8, 10, 12, 15, 20, 30 };
+
+struct sweep_config {
+    int rho_res_log;  // RHO_RESOLUTION_LOG
+    int thetas;       // THETAS over 180 degrees
+    int top_n;        // TOP_N
+    int bits;         // BITS of the sin/cos tables and the steering arithmetic
+};
+
+struct sweep_frame {
+    char name[64];
+    int height;
+    int width;
+    int edge_pixels;
+    unsigned char *edges;
+    unsigned char *blurred;  // Blurred image the edges were detected on
+    float ref_steering;   // Float reference
+    int ref_found;        // Reference found both lanes
+    int golden_steering;  // calculate_center_lane() on the golden accumulator
+};
+
+struct sweep_result {
+    struct sweep_config cfg;
+    int rhos;                 // For the largest frame
+    long long accum_bytes;    // 16-bit accumulator for the largest frame
+    int band_thetas;          // Thetas voted per edge pixel
+    double votes_per_frame;
+    double mean_error;        // Mean |steering - reference| over frames where both found lanes
+    double max_error;
+    int lost;                 // Frames where the reference found both lanes and this point did not
+    int golden_mismatches;    // Golden configuration only: frames that differ from calculate_center_lane()
+};
+
+static int sweep_diagonal(int height, int width) {
+    return (int)ceil(sqrt((double)height * height + (double)width * width));
+}
+
+static int sweep_rhos(int height, int width, int rho_res_log) {
+    // hough_rhos() for any RHO_RESOLUTION
+    int res = 1 << rho_res_log;
+    return (sweep_diagonal(height, width) + res - 1) / res;
+}
+
+static inline int sweep_theta_deg(int t, int thetas) {
+    return (t * 180) / thetas;
+}
+
+static inline int sweep_in_band(int deg) {
+    return (deg >= LEFT_LANE_LB && deg <= LEFT_LANE_UB) || (deg >= RIGHT_LANE_LB && deg <= RIGHT_LANE_UB);
+}
+
+static void sweep_top_lines(const unsigned short *accumulator, int rhos, int thetas, int top_n, int *rho_indices, int *theta_indices, int *vote_counts) {
+    // extract_top_lines() for any accumulator size
+    for (int i = 0; i < top_n; i++) {
+        vote_counts[i] = rho_indices[i] = theta_indices[i] = 0;
+    }
+    int min_idx = 0;
+    for (int r = 0; r < rhos; r++) {
+        for (int t = 0; t < thetas; t++) {
+            int votes = accumulator[r * thetas + t];
+            if (votes > vote_counts[min_idx]) {
+                vote_counts[min_idx] = votes;
+                rho_indices[min_idx] = r;
+                theta_indices[min_idx] = t;
+                for (int i = 0; i < top_n; i++) {
+                    if (vote_counts[i] < vote_counts[min_idx]) min_idx = i;
+                }
+            }
+        }
+    }
+}
+
+static int sweep_select_lanes(int thetas, int top_n, const int *rho_indices, const int *theta_indices, const int *vote_counts, int *left, int *right) {
+    // calculate_center_lane()'s classification with the band edges and centres in degrees,
+    // returns 0 when both lanes were found
+    int left_center = 130 * thetas / 180;
+    int right_center = 50 * thetas / 180;
+    int left_theta = -1, right_theta = -1;
+    int top_left_votes = -1, top_right_votes = -1;
+    *left = *right = -1;
+    for (int i = 0; i < top_n; i++) {
+        int theta = theta_indices[i];
+        int deg = sweep_theta_deg(theta, thetas);
+        int votes = vote_counts[i];
+        if (deg >= LEFT_LANE_LB && deg <= LEFT_LANE_UB && top_left_votes <= votes) {
+            if (top_left_votes < votes || (abs(theta - left_center) < abs(left_theta - left_center) && top_left_votes == votes)) {
+                left_theta = theta;
+                top_left_votes = votes;
+                *left = i;
+            }
+        } else if (deg >= RIGHT_LANE_LB && deg <= RIGHT_LANE_UB && top_right_votes <= votes) {
+            if (top_right_votes < votes || (abs(theta - right_center) < abs(right_theta - right_center) && top_right_votes == votes)) {
+                right_theta = theta;
+                top_right_votes = votes;
+                *right = i;
+            }
+        }
+    }
+    (void)rho_indices;
+    return *left >= 0 && *right >= 0 ? 0 : -1;
+}
+
+static int sweep_run_point(const struct sweep_config *cfg, const struct sweep_frame *fr, unsigned short *accumulator, int *found, long long *votes) {
+/**
+    * @brief Runs the quantized back end of one design point on one frame.
+    *
+    * With RHO_RESOLUTION_LOG 2, THETAS 180, TOP_N 16 and BITS 10 this is
+    * calculate_center_lane(extract_top_lines(hough_transform())) exactly.
+    *
+    * @return Steering as a signed 10-bit value.
+*/
+    int thetas = cfg->thetas;
+    int bits = cfg->bits;
+    int quant = 1 << bits;
+    int rhos = sweep_rhos(fr->height, fr->width, cfg->rho_res_log);
+
+    // lanedetect_const.c: QUANTIZE_F of the float tables
+    int sin_q[180], cos_q[180];
+    for (int t = 0; t < thetas; t++) {
+        float angle = (float)(M_PI * t / thetas);
+        sin_q[t] = (int)((float)sin(angle) * (float)quant);
+        cos_q[t] = (int)((float)cos(angle) * (float)quant);
+    }
+
+    memset(accumulator, 0, sizeof(unsigned short) * rhos * thetas);
+    int band[180];
+    int n_band = 0;
+    for (int t = 0; t < thetas; t++) {
+        if (sweep_in_band(sweep_theta_deg(t, thetas))) band[n_band++] = t;
+    }
+    long long cast = 0;
+    for (int y = 0; y < fr->height; y++) {
+        int ys = (y - fr->height / 2) >> cfg->rho_res_log;
+        for (int x = 0; x < fr->width; x++) {
+            if (fr->edges[y * fr->width + x] == 0) continue;
+            int xs = (x - fr->width / 2) >> cfg->rho_res_log;
+            for (int b = 0; b < n_band; b++) {
+                int t = band[b];
+                int rho = (xs * cos_q[t] + ys * sin_q[t]) / quant + (rhos >> 1);
+                if (rho >= 0 && rho < rhos) accumulator[rho * thetas + t]++;
+            }
+            cast += n_band;
+        }
+    }
+    *votes = cast;
+
+    int rho_indices[SWEEP_MAX_TOP_N], theta_indices[SWEEP_MAX_TOP_N], vote_counts[SWEEP_MAX_TOP_N];
+    sweep_top_lines(accumulator, rhos, thetas, cfg->top_n, rho_indices, theta_indices, vote_counts);
+    int left, right;
+    *found = sweep_select_lanes(thetas, cfg->top_n, rho_indices, theta_indices, vote_counts, &left, &right) == 0;
+    if (!*found) return 0;
+
+    // calculate_center_lane() in Q(bits)
+    // 64-bit, the products outgrow an int from 12 bits on at 720x540
+    int lt = theta_indices[left], rt = theta_indices[right];
+    if (cos_q[lt] == 0 || cos_q[rt] == 0) {
+        *found = 0;
+        return 0;
+    }
+    int64_t left_rho_q = (int64_t)(rho_indices[left] - (rhos >> 1)) * (1 << cfg->rho_res_log) * quant;
+    int64_t right_rho_q = (int64_t)(rho_indices[right] - (rhos >> 1)) * (1 << cfg->rho_res_log) * quant;
+    int64_t center_y_q = (int64_t)(fr->height / 2) * quant;
+    int64_t numerator_l = left_rho_q + ((center_y_q * sin_q[lt]) >> bits);
+    int64_t numerator_r = right_rho_q + ((center_y_q * sin_q[rt]) >> bits);
+    // Truncating division, as the sign-corrected division in calculate_center_lane()
+    int64_t left_x = numerator_l / cos_q[lt];
+    int64_t right_x = numerator_r / cos_q[rt];
+    int64_t offset = -((left_x + right_x) >> 1);
+    int angle_error = (((lt + rt) * 180 / thetas) >> 1) - 90;
+    int offset_q = (int)(OFFSET * (float)quant);
+    int angle_q = (int)(ANGLE * (float)quant);
+    int steering = (int)(((offset * offset_q + (int64_t)angle_error * angle_q) >> bits) & 0x3FF);
+    return steering >= 512 ? steering - 1024 : steering;
+}
+
+static int sweep_reference(const struct sweep_frame *fr, float *steering, int *found) {
+    // Float Hough with 1-pixel rho bins over 1 degree thetas, and float steering, -1 if out of memory
+    int rhos = sweep_rhos(fr->height, fr->width, 0) * 2 + 1;
+    unsigned short *accumulator = calloc((size_t)rhos * 180, sizeof(unsigned short));
+    if (!accumulator) return -1;
+    for (int y = 0; y < fr->height; y++) {
+        float cy = (float)(y - fr->height / 2);
+        for (int x = 0; x < fr->width; x++) {
+            if (fr->edges[y * fr->width + x] == 0) continue;
+            float cx = (float)(x - fr->width / 2);
+            for (int t = 0; t < 180; t++) {
+                if (!sweep_in_band(t)) continue;
+                int rho = (int)floorf(cx * cosvals[t] + cy * sinvals[t] + 0.5f) + rhos / 2;
+                if (rho >= 0 && rho < rhos) accumulator[rho * 180 + t]++;
+            }
+        }
+    }
+    int rho_indices[SWEEP_REF_TOP_N], theta_indices[SWEEP_REF_TOP_N], vote_counts[SWEEP_REF_TOP_N];
+    sweep_top_lines(accumulator, rhos, 180, SWEEP_REF_TOP_N, rho_indices, theta_indices, vote_counts);
+    free(accumulator);
+
+    int left, right;
+    *steering = 0.0f;
+    *found = sweep_select_lanes(180, SWEEP_REF_TOP_N, rho_indices, theta_indices, vote_counts, &left, &right) == 0;
+    if (!*found) return 0;
+    int lt = theta_indices[left], rt = theta_indices[right];
+    float center_y = (float)(fr->height / 2);
+    float left_x = ((float)(rho_indices[left] - rhos / 2) + center_y * sinvals[lt]) / cosvals[lt];
+    float right_x = ((float)(rho_indices[right] - rhos / 2) + center_y * sinvals[rt]) / cosvals[rt];
+    float offset = -(left_x + right_x) / 2.0f;
+    float angle_error = (lt + rt) / 2.0f - 90.0f;
+    *steering = offset * OFFSET + angle_error * ANGLE;
+    return 0;
+}
+
+// Sweep Workers
+//  Design points are handed out one at a time from a shared counter, every worker has its own
+//  accumulator and writes only its own results.
+struct sweep_job {
+    const struct sweep_frame *frames;
+    int n_frames;
+    int max_height;
+    int max_width;
+    struct sweep_result *results;
+    int n_points;
+    int next;
+    pthread_mutex_t mutex;
+};
+
+static void *sweep_worker(void *arg) {
+    struct sweep_job *job = arg;
+    int max_rhos = sweep_rhos(job->max_height, job->max_width, 0);
+    unsigned short *accumulator = malloc(sizeof(unsigned short) * max_rhos * 180);
+    if (!accumulator) return NULL;
+
+    for (;;) {
+        pthread_mutex_lock(&job->mutex);
+        int p = job->next++;
+        pthread_mutex_unlock(&job->mutex);
+        if (p >= job->n_points) break;
+
+        struct sweep_result *res = &job->results[p];
+        const struct sweep_config *cfg = &res->cfg;
+        int is_golden = cfg->rho_res_log == RHO_RESOLUTION_LOG && cfg->thetas == THETAS && cfg->top_n == TOP_N && cfg->bits == BITS;
+        long long votes_total = 0;
+        double error_total = 0.0;
+        int scored = 0;
+
+        res->rhos = sweep_rhos(job->max_height, job->max_width, cfg->rho_res_log);
+        res->accum_bytes = (long long)res->rhos * cfg->thetas * sizeof(unsigned short);
+        res->band_thetas = 0;
+        for (int t = 0; t < cfg->thetas; t++) {
+            res->band_thetas += sweep_in_band(sweep_theta_deg(t, cfg->thetas));
+        }
+
+        for (int f = 0; f < job->n_frames; f++) {
+            const struct sweep_frame *fr = &job->frames[f];
+            int found;
+            long long votes;
+            int steering = sweep_run_point(cfg, fr, accumulator, &found, &votes);
+            votes_total += votes;
+            if (is_golden && (steering & 0x3FF) != fr->golden_steering) {
+                res->golden_mismatches++;
+            }
+            if (!fr->ref_found) continue;
+            if (!found) {
+                res->lost++;
+                continue;
+            }
+            double error = fabs(steering - fr->ref_steering);
+            error_total += error;
+            if (error > res->max_error) res->max_error = error;
+            scored++;
+        }
+        res->votes_per_frame = (double)votes_total / job->n_frames;
+        res->mean_error = scored > 0 ? error_total / scored : 0.0;
+    }
+    free(accumulator);
+    return NULL;
+}
+
+static int sweep_frame_load(const char *path, struct sweep_frame *fr) {
+    struct bmp_view view;
+    if (bmp_view_open(path, &view) != 0) return -1;
+
+    const char *base = strrchr(path, '/');
+    snprintf(fr->name, sizeof fr->name, "%.63s", base ? base + 1 : path);
+    fr->height = view.height;
+    fr->width = view.width;
+    fr->edges = malloc((size_t)view.height * view.width);
+    fr->blurred = malloc((size_t)view.height * view.width);
+    unsigned char *lanes = malloc((size_t)view.height * view.width);
+    int rhos = hough_rhos(view.height, view.width);
+    unsigned int *accumulator = malloc(sizeof(unsigned int) * rhos * THETAS);
+    struct edge_stream *stream = edge_stream_create(view.height, view.width);
+    int res = -1;
+    if (fr->edges && fr->blurred && lanes && accumulator && stream &&
+        edge_stream_frame_strided(stream, view.pixels, view.stride, fr->edges, accumulator) == 0) {
+        // The golden front end up to the blur, the gradient of every edge pixel is taken from it
+        convert_to_grayscale_strided(view.pixels, view.stride, view.height, view.width, lanes);
+        gaussian_blur_separable(lanes, view.height, view.width, fr->blurred);
+        int rho_indices[TOP_N], theta_indices[TOP_N], vote_counts[TOP_N];
+        int left_rho_idx, left_theta_idx, right_rho_idx, right_theta_idx;
+        extract_top_lines(accumulator, rhos, rho_indices, theta_indices, vote_counts);
+        memcpy(lanes, fr->edges, (size_t)view.height * view.width);
+        fr->golden_steering = (int)calculate_center_lane(lanes, view.height, view.width, rho_indices, theta_indices, vote_counts,
+                                                         &left_rho_idx, &left_theta_idx, &right_rho_idx, &right_theta_idx);
+        fr->edge_pixels = 0;
+        for (int i = 0; i < view.height * view.width; i++) {
+            fr->edge_pixels += fr->edges[i] != 0;
+        }
+        res = sweep_reference(fr, &fr->ref_steering, &fr->ref_found);
+    }
+    edge_stream_destroy(stream);
+    free(accumulator);
+    free(lanes);
+    bmp_view_close(&view);
+    if (res != 0) {
+        free(fr->edges);
+        free(fr->blurred);
+    }
+    return res;
+}
+
+// Gradient Window Sweep
+//  Every k votes each frame through hough_transform_gradient() and runs the golden peak
+//  extraction and lane selection, so k = full reproduces calculate_center_lane().
+struct sweep_gradient_result {
+    int k;                   // -1 for full lane-band voting
+    double votes_per_frame;
+    int same_lanes;          // Frames whose lanes (rho and theta) match full voting
+    int same_steering;       // Frames whose steering matches full voting
+    double theta_shift;      // Mean |theta - full voting theta| of the lanes where both found them
+    double mean_error;       // Mean |steering - reference| over frames where both found lanes
+    double max_error;
+    int lost;                // Frames where the reference found both lanes and this k did not
+};
+
+static void sweep_gradient_point(const struct sweep_frame *frames, int n_frames, int k, struct lanedetect_result *full,
+                                 struct sweep_gradient_result *res) {
+    long long votes = 0;
+    double error_total = 0.0, shift_total = 0.0;
+    int scored = 0, shifted = 0;
+    memset(res, 0, sizeof *res);
+    res->k = k;
+    for (int f = 0; f < n_frames; f++) {
+        const struct sweep_frame *fr = &frames[f];
+        int rhos = hough_rhos(fr->height, fr->width);
+        unsigned int *accumulator = malloc(sizeof(unsigned int) * rhos * THETAS);
+        struct hough_lut *lut = hough_lut_create(fr->height, fr->width);
+        struct edge_bitmap *bm = edge_bitmap_create(fr->height, fr->width);
+        struct gradient_windows gradient;
+        struct lanedetect_result result;
+        if (!accumulator || !lut || !bm) {
+            free(accumulator);
+            hough_lut_destroy(lut);
+            edge_bitmap_destroy(bm);
+            continue;
+        }
+
+        edge_bitmap_pack(bm, fr->edges);
+        gradient_windows_init(&gradient, lut, k);
+        int out_of_range = hough_transform_gradient(lut, &gradient, bm, fr->blurred, accumulator);
+        int saturated;
+        votes += hough_accumulator_stats(accumulator, rhos, &saturated) + out_of_range;
+        int rho_indices[TOP_N], theta_indices[TOP_N], vote_counts[TOP_N];
+        extract_top_lines(accumulator, rhos, rho_indices, theta_indices, vote_counts);
+        lane_steering(fr->height, fr->width, ROI_DEFAULT_ROWS(fr->height), rho_indices, theta_indices, vote_counts, &result);
+        free(accumulator);
+        hough_lut_destroy(lut);
+        edge_bitmap_destroy(bm);
+
+        if (k < 0) full[f] = result;
+        res->same_lanes += result.left_rho_idx == full[f].left_rho_idx && result.left_theta_idx == full[f].left_theta_idx &&
+                           result.right_rho_idx == full[f].right_rho_idx && result.right_theta_idx == full[f].right_theta_idx;
+        res->same_steering += result.status == full[f].status && result.steering == full[f].steering;
+        if (result.status == LANEDETECT_OK && full[f].status == LANEDETECT_OK) {
+            shift_total += abs(result.left_theta_idx - full[f].left_theta_idx) + abs(result.right_theta_idx - full[f].right_theta_idx);
+            shifted += 2;
+        }
+        if (!fr->ref_found) continue;
+        if (result.status != LANEDETECT_OK) {
+            res->lost++;
+            continue;
+        }
+        int steering = (int)result.steering;
+        double error = fabs((steering >= 512 ? steering - 1024 : steering) - fr->ref_steering);
+        error_total += error;
+        if (error > res->max_error) res->max_error = error;
+        scored++;
+    }
+    res->votes_per_frame = (double)votes / n_frames;
+    res->mean_error = scored > 0 ? error_total / scored : 0.0;
+    res->theta_shift = shifted > 0 ? shift_total / shifted : 0.0;
+}
+
+static int sweep_gradient(const struct sweep_frame *frames, int n_frames, double tolerance, FILE *csv) {
+/**
+    * @brief Sweeps the k of gradient-constrained voting against full lane-band voting.
+    *
+    * @return 0 on success, 1 on failure.
+*/
+    int n_ks = sizeof sweep_gradient_ks / sizeof sweep_gradient_ks[0];
+    struct lanedetect_result *full = malloc(sizeof(struct lanedetect_result) * n_frames);
+    if (!full) return 1;
+
+    struct sweep_gradient_result golden, best = { 0 }, r;
+    sweep_gradient_point(frames, n_frames, -1, full, &golden);
+    int mismatches = 0;
+    for (int f = 0; f < n_frames; f++) {
+        mismatches += ((int)full[f].steering & 0x3FF) != frames[f].golden_steering;
+    }
+    if (mismatches > 0) {
+        fprintf(stderr, "Warning: full voting differs from calculate_center_lane() on %d frames\n", mismatches);
+    }
+
+    fprintf(csv, "k,votes_per_frame,vote_reduction,same_lanes,same_steering,theta_shift,mean_error,max_error,lost_frames\n");
+    fprintf(csv, "full,%.1f,1.0,%d,%d,%.2f,%.3f,%.3f,%d\n", golden.votes_per_frame, golden.same_lanes, golden.same_steering,
+            golden.theta_shift, golden.mean_error, golden.max_error, golden.lost);
+    best.k = -1;
+    for (int i = 0; i < n_ks; i++) {
+        sweep_gradient_point(frames, n_frames, sweep_gradient_ks[i], full, &r);
+        double reduction = r.votes_per_frame > 0 ? golden.votes_per_frame / r.votes_per_frame : 0.0;
+        fprintf(csv, "%d,%.1f,%.1f,%d,%d,%.2f,%.3f,%.3f,%d\n", r.k, r.votes_per_frame, reduction, r.same_lanes, r.same_steering,
+                r.theta_shift, r.mean_error, r.max_error, r.lost);
+        if (best.k < 0 && r.mean_error <= golden.mean_error + tolerance && r.lost <= golden.lost) best = r;
+    }
+    free(full);
+
+    fprintf(stderr, "Frames: %d, full voting: mean error %.3f, %d lost, %.0f votes/frame\n", n_frames, golden.mean_error, golden.lost,
+            golden.votes_per_frame);
+    if (best.k >= 0) {
+        fprintf(stderr, "Smallest k within %.2f: k %d: mean error %.3f, %d lost, %.0f votes/frame (%.1fx fewer), lanes %.2f thetas from full voting\n",
+                tolerance, best.k, best.mean_error, best.lost, best.votes_per_frame, golden.votes_per_frame / best.votes_per_frame,
+                best.theta_shift);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    double tolerance = 1.0;
+    int gradient = 0;
+    int first_path = argc;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--gradient") == 0) {
+            gradient = 1;
+        } else if (argv[i][0] != '-') {
+            first_path = i;
+            break;
+        } else {
+            printf("Usage: %s [--threads N] [--tolerance T] [--gradient] [image_dir | file.bmp ...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+
+    // The golden model prints its diagnostics on stdout, so the CSV goes to a copy of it
+    fflush(stdout);
+    FILE *csv = fdopen(dup(fileno(stdout)), "w");
+    if (!csv || !freopen("/dev/null", "w", stdout)) {
+        fprintf(stderr, "Error: Could not redirect stdout\n");
+        return 1;
+    }
+
+    int capacity = 16;
+    struct sweep_job job = { 0 };
+    struct sweep_frame *frames = malloc(sizeof(struct sweep_frame) * capacity);
+    if (!frames) {
+        fprintf(stderr, "Error: Failed to allocate frames\n");
+        return 1;
+    }
+    const char *default_dir[] = { "images" };
+    const char **paths = first_path < argc ? (const char **)&argv[first_path] : default_dir;
+    int n_paths = first_path < argc ? argc - first_path : 1;
+    for (int p = 0; p < n_paths; p++) {
+        struct stat st;
+        struct dirent **entries = NULL;
+        int n = 0;
+        if (stat(paths[p], &st) == 0 && S_ISDIR(st.st_mode)) {
+            n = scandir(paths[p], &entries, frame_source_bmp_filter, alphasort);
+        }
+        for (int e = 0; e < (n > 0 ? n : 1); e++) {
+            char path[1024];
+            if (n > 0) {
+                snprintf(path, sizeof path, "%s/%s", paths[p], entries[e]->d_name);
+                free(entries[e]);
+            } else {
+                snprintf(path, sizeof path, "%s", paths[p]);
+            }
+            if (job.n_frames == capacity) {
+                struct sweep_frame *grown = realloc(frames, sizeof(struct sweep_frame) * capacity * 2);
+                if (!grown) {
+                    fprintf(stderr, "Error: Failed to allocate frames, skipping %s\n", path);
+                    continue;
+                }
+                frames = grown;
+                capacity *= 2;
+            }
+            if (sweep_frame_load(path, &frames[job.n_frames]) != 0) {
+                fprintf(stderr, "Error: Skipping %s\n", path);
+                continue;
+            }
+            struct sweep_frame *fr = &frames[job.n_frames++];
+            if (fr->height * fr->width > job.max_height * job.max_width) {
+                job.max_height = fr->height;
+                job.max_width = fr->width;
+            }
+        }
+        free(entries);
+    }
+    if (job.n_frames == 0) {
+        fprintf(stderr, "Error: No frames to sweep\n");
+        return 1;
+    }
+    if (gradient) {
+        int res = sweep_gradient(frames, job.n_frames, tolerance, csv);
+        fclose(csv);
+        for (int f = 0; f < job.n_frames; f++) {
+            free(frames[f].edges);
+            free(frames[f].blurred);
+        }
+        free(frames);
+        return res;
+    }
+
+    // Every combination of the swept parameters
+    int n_res = sizeof sweep_rho_res_logs / sizeof sweep_rho_res_logs[0];
+    int n_thetas = sizeof sweep_thetas / sizeof sweep_thetas[0];
+    int n_top = sizeof sweep_top_ns / sizeof sweep_top_ns[0];
+    int n_bits = sizeof sweep_bits / sizeof sweep_bits[0];
+    job.frames = frames;
+    job.n_points = n_res * n_thetas * n_top * n_bits;
+    job.results = calloc(job.n_points, sizeof(struct sweep_result));
+    if (!job.results) {
+        fprintf(stderr, "Error: Failed to allocate sweep results\n");
+        return 1;
+    }
+    pthread_mutex_init(&job.mutex, NULL);
+    int p = 0;
+    for (int a = 0; a < n_res; a++) {
+        for (int b = 0; b < n_thetas; b++) {
+            for (int c = 0; c < n_top; c++) {
+                for (int d = 0; d < n_bits; d++) {
+                    struct sweep_config cfg = { sweep_rho_res_logs[a], sweep_thetas[b], sweep_top_ns[c], sweep_bits[d] };
+                    job.results[p++].cfg = cfg;
+                }
+            }
+        }
+    }
+
+    pthread_t *workers = malloc(sizeof(pthread_t) * threads);
+    if (!workers) {
+        fprintf(stderr, "Error: Failed to allocate sweep workers\n");
+        return 1;
+    }
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&workers[i], NULL, sweep_worker, &job) != 0) break;
+        started++;
+    }
+    if (started == 0) sweep_worker(&job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&job.mutex);
+
+    fprintf(csv, "rho_resolution,rhos,thetas,top_n,bits,accum_bytes,band_thetas,votes_per_frame,mean_error,max_error,lost_frames\n");
+    const struct sweep_result *golden = NULL;
+    for (int i = 0; i < job.n_points; i++) {
+        const struct sweep_result *r = &job.results[i];
+        fprintf(csv, "%d,%d,%d,%d,%d,%lld,%d,%.1f,%.3f,%.3f,%d\n", 1 << r->cfg.rho_res_log, r->rhos, r->cfg.thetas,
+                r->cfg.top_n, r->cfg.bits, r->accum_bytes, r->band_thetas, r->votes_per_frame, r->mean_error, r->max_error, r->lost);
+        if (r->cfg.rho_res_log == RHO_RESOLUTION_LOG && r->cfg.thetas == THETAS && r->cfg.top_n == TOP_N && r->cfg.bits == BITS) {
+            golden = r;
+        }
+    }
+    fclose(csv);
+
+    if (golden) {
+        if (golden->golden_mismatches > 0) {
+            fprintf(stderr, "Warning: golden configuration differs from calculate_center_lane() on %d frames\n", golden->golden_mismatches);
+        }
+        const struct sweep_result *best = NULL;
+        for (int i = 0; i < job.n_points; i++) {
+            const struct sweep_result *r = &job.results[i];
+            if (r->mean_error > golden->mean_error + tolerance || r->lost > golden->lost) continue;
+            if (!best || r->accum_bytes < best->accum_bytes ||
+                (r->accum_bytes == best->accum_bytes && r->votes_per_frame < best->votes_per_frame) ||
+                (r->accum_bytes == best->accum_bytes && r->votes_per_frame == best->votes_per_frame && r->cfg.bits < best->cfg.bits)) {
+                best = r;
+            }
+        }
+        fprintf(stderr, "Frames: %d, design points: %d, threads: %d\n", job.n_frames, job.n_points, threads);
+        fprintf(stderr, "Golden (RHO_RESOLUTION %d, THETAS %d, TOP_N %d, BITS %d): mean error %.3f, %d lost, %lld accumulator bytes\n",
+                RHO_RESOLUTION, THETAS, TOP_N, BITS, golden->mean_error, golden->lost, golden->accum_bytes);
+        if (best) {
+            fprintf(stderr, "Cheapest within %.2f: RHO_RESOLUTION %d, THETAS %d, TOP_N %d, BITS %d: mean error %.3f, %d lost, %lld accumulator bytes, %.0f votes/frame\n",
+                    tolerance, 1 << best->cfg.rho_res_log, best->cfg.thetas, best->cfg.top_n, best->cfg.bits,
+                    best->mean_error, best->lost, best->accum_bytes, best->votes_per_frame);
+        }
+    }
+
+    for (int f = 0; f < job.n_frames; f++) {
+        free(frames[f].edges);
+        free(frames[f].blurred);
+    }
+    free(frames);
+    free(job.results);
+    free(workers);
+    return 0;
+}